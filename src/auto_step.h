@@ -0,0 +1,476 @@
+#pragma once
+
+#include "auto_task.h"
+#include "constants.h"
+#include "timer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <variant>
+
+enum class MotorAction : uint8_t {
+	MoveVoltage,
+	MoveAbsolute,
+	Brake,
+};
+
+enum class Direction : uint8_t {
+	Clockwise,
+	CounterClockwise,
+};
+
+/*
+ * Each kind of autonomous step only stores the fields it actually uses. The
+ * steps are held in an std::variant, so a step costs the size of its largest
+ * action rather than the sum of all of them.
+ */
+struct WaitUntilMatchTime {
+	float clock_time_s;
+};
+
+struct ResetIMU {};
+
+struct WaitForIMU {};
+
+struct TurnIMUFromStart {
+	float degree_target;
+	float target_range;
+	float left_drive_voltage;
+	float right_drive_voltage;
+	Direction direction;
+};
+
+struct DriveSide {
+	MotorAction action;
+	float target;
+	float speed;
+};
+
+struct DriveAction {
+	DriveSide left;
+	DriveSide right;
+	uint8_t required_num_to_procede;
+	bool chained;
+	// Drive both sides to the same target, trimming them to keep the
+	// heading the step started at
+	bool hold_heading;
+	// Drive units from the target and RPM a MoveAbsolute side has to settle
+	// within, 0 for DRIVE_SETTLE_RANGE and DRIVE_SETTLE_RPM
+	float settle_range;
+	float settle_rpm;
+};
+
+// Point on a path, in inches in the same field frame as Pose
+struct PathPoint {
+	float x;
+	float y;
+};
+
+struct FollowPath {
+	const PathPoint *points;
+	uint16_t num_points;
+	float lookahead;
+	float max_voltage;
+	bool reversed;
+};
+
+/*
+ * State along a time parameterized trajectory, in the same field frame and
+ * units as Pose. curvature is in 1 / inches, positive turning right.
+ */
+struct TrajectoryPoint {
+	float time_s;
+	float x;
+	float y;
+	float heading;
+	float velocity;
+	float curvature;
+};
+
+struct FollowTrajectory {
+	const TrajectoryPoint *points;
+	uint16_t num_points;
+};
+
+// Pose to drive to, in the same field frame and units as Pose
+struct MoveToPose {
+	float x;
+	float y;
+	float heading;
+	// How far the carrot point is pulled back from the target along its
+	// heading, as a fraction of the distance left
+	float lead;
+	// Limits on the forward and turning parts of the drive voltage
+	float max_linear;
+	float max_angular;
+	bool reversed;
+};
+
+struct IntakeSetExtend {
+	float rpm;
+	bool extend;
+};
+
+struct IntakeSpin {
+	float voltage;
+};
+
+struct DeployCatapult {};
+
+struct WaitForCatapultDeploy {};
+
+struct FireCatapultTime {
+	float voltage;
+};
+
+struct WaitForCatapultEngage {};
+
+struct WaitForCatapultSlip {};
+
+struct RunBlockingLambda {
+	void (*func)(Timer &auto_timer);
+};
+
+struct RunTask {
+	AutoTaskFunc func;
+};
+
+struct Join {};
+
+using AutoAction =
+	std::variant<WaitUntilMatchTime, ResetIMU, WaitForIMU, TurnIMUFromStart,
+		     DriveAction, FollowPath, FollowTrajectory, MoveToPose,
+		     IntakeSetExtend, IntakeSpin, DeployCatapult,
+		     WaitForCatapultDeploy, FireCatapultTime,
+		     WaitForCatapultEngage, WaitForCatapultSlip,
+		     RunBlockingLambda, RunTask, Join>;
+
+#define NUM_AUTO_TRACKS 3
+
+/*
+ * Bit mask of the tracks a step runs on. Every track walks the step list with
+ * its own cursor, only stopping on steps that include it, and all tracks are
+ * advanced in the same loop tick. A step on several tracks only starts once
+ * every one of those tracks has reached it, so it doubles as a join point.
+ * Steps default to all tracks, which runs a routine strictly in order.
+ */
+enum AutoTrack : uint8_t {
+	DriveTrack = 1 << 0,
+	IntakeTrack = 1 << 1,
+	CatapultTrack = 1 << 2,
+	AllTracks = DriveTrack | IntakeTrack | CatapultTrack,
+};
+
+/*
+ * When the sequencer knows how long autonomous lasts, it first sets aside the
+ * estimated cost of every critical step still to come on a step's tracks.
+ * Normal steps have their timeout cut to what is left, optional steps are
+ * skipped if their cost no longer fits, and critical steps always run in full.
+ */
+enum class StepPriority : uint8_t {
+	Optional,
+	Normal,
+	Critical,
+};
+
+/*
+ * The static factories below are constexpr so whole routines can be written as
+ * constexpr AutoStep tables. Those live in flash and cost nothing to build
+ * when autonomous starts.
+ */
+struct AutoStep {
+	AutoAction action;
+	float timeout_ms;
+	uint32_t delay_ms_after_done = 0;
+	uint8_t tracks = AllTracks;
+	StepPriority priority = StepPriority::Normal;
+	// Expected run time including delay_ms_after_done, 0 to assume the
+	// whole timeout. Critical steps must set it, since their whole timeout
+	// would be reserved from every step before them.
+	uint16_t cost_ms = 0;
+
+	// Returns a copy of this step whose cost_ms, which must not be 0, is
+	// always reserved
+	constexpr AutoStep critical(uint16_t step_cost_ms) const
+	{
+		AutoStep step = *this;
+		step.priority = StepPriority::Critical;
+		step.cost_ms = step_cost_ms;
+		return step;
+	}
+
+	// Returns a copy of this step that is dropped when its cost_ms no
+	// longer fits in front of the critical steps
+	constexpr AutoStep optional(uint16_t step_cost_ms) const
+	{
+		AutoStep step = *this;
+		step.priority = StepPriority::Optional;
+		step.cost_ms = step_cost_ms;
+		return step;
+	}
+
+	// Returns a copy of this drive step that flows straight into the next
+	// drive step, without braking, re-zeroing the encoders or slowing down
+	// at its target
+	constexpr AutoStep chained() const
+	{
+		AutoStep step = *this;
+		if (auto drive = std::get_if<DriveAction>(&step.action))
+			drive->chained = true;
+		return step;
+	}
+
+	// Returns a copy of this drive step that finishes once each side is
+	// within range drive units of its target and slower than rpm
+	constexpr AutoStep settle_within(double range, double rpm = 0.0) const
+	{
+		AutoStep step = *this;
+		if (auto drive = std::get_if<DriveAction>(&step.action)) {
+			drive->settle_range = (float)range;
+			drive->settle_rpm = (float)rpm;
+		}
+		return step;
+	}
+
+	// Returns a copy of this step that only runs on the given tracks
+	constexpr AutoStep on(uint8_t step_tracks) const
+	{
+		AutoStep step = *this;
+		step.tracks = step_tracks;
+		return step;
+	}
+
+	static constexpr AutoStep wait_until_match_time(double time_s)
+	{
+		return { WaitUntilMatchTime{ (float)time_s }, 10000000 };
+	}
+
+	static constexpr AutoStep reset_imu(double timeout_ms)
+	{
+		return { ResetIMU{}, (float)timeout_ms };
+	}
+
+	// Waits for the IMU calibration initialize() started, so the turns
+	// after it steer from the IMU rather than the encoders. Timing out
+	// carries on with the encoder heading.
+	static constexpr AutoStep wait_for_imu(double timeout_ms = 3000)
+	{
+		return { WaitForIMU{}, (float)timeout_ms };
+	}
+
+	/*
+	 * Turns to degrees of odometry heading with TurnController, using at
+	 * most drive_voltage. The heading is the IMU's once it has calibrated
+	 * and the drive encoders' before then, so put a wait_for_imu() ahead
+	 * of the first turn. The controller turns whichever
+	 * way the error is, so direction only documents which way the turn
+	 * goes. Finishes once the robot has settled within turn_target_range
+	 * degrees.
+	 */
+	static constexpr AutoStep turn_imu(Direction direction, double degrees,
+					   double drive_voltage,
+					   double timeout_ms,
+					   uint32_t delay_ms_after_done = 5,
+					   double turn_target_range = 2.0)
+	{
+		return turn_imu_separate(direction, degrees, drive_voltage,
+					 drive_voltage, timeout_ms,
+					 delay_ms_after_done,
+					 turn_target_range);
+	}
+
+	// A side with a voltage of 0 holds still, pivoting about it
+	static constexpr AutoStep
+	turn_imu_separate(Direction direction, double degrees,
+			  double left_drive_voltage, double right_drive_voltage,
+			  double timeout_ms, uint32_t delay_ms_after_done = 5,
+			  double turn_target_range = 2.0)
+	{
+		return { TurnIMUFromStart{ (float)degrees,
+					   (float)turn_target_range,
+					   (float)left_drive_voltage,
+					   (float)right_drive_voltage,
+					   direction },
+			 (float)timeout_ms, delay_ms_after_done };
+	}
+
+	static constexpr AutoStep move_position(double drive_target,
+						double drive_rpm,
+						double timeout_ms)
+	{
+		return move_position(drive_target, drive_target, drive_rpm,
+				     drive_rpm, timeout_ms);
+	}
+
+	static constexpr AutoStep move_position(
+		double left_drive_target, double right_drive_target,
+		double left_drive_rpm, double right_drive_rpm,
+		double timeout_ms,
+		MotorAction left_drive_action = MotorAction::MoveAbsolute,
+		MotorAction right_drive_action = MotorAction::MoveAbsolute)
+	{
+		return { DriveAction{ { left_drive_action,
+					(float)left_drive_target,
+					(float)left_drive_rpm },
+				      { right_drive_action,
+					(float)right_drive_target,
+					(float)right_drive_rpm },
+				      2 },
+			 (float)timeout_ms };
+	}
+
+	// Drives straight to drive_target, steering against any heading the
+	// drive picks up on the way instead of leaving it for a corrective turn
+	static constexpr AutoStep move_straight(double drive_target,
+						double drive_rpm,
+						double timeout_ms)
+	{
+		AutoStep step = move_position(drive_target, drive_rpm,
+					      timeout_ms);
+		std::get<DriveAction>(step.action).hold_heading = true;
+		return step;
+	}
+
+	static constexpr AutoStep drive_power(double drive_voltage,
+					      double timeout_ms)
+	{
+		return drive_power(drive_voltage, drive_voltage, timeout_ms);
+	}
+
+	static constexpr AutoStep drive_power(double drive_voltage_left,
+					      double drive_voltage_right,
+					      double timeout_ms)
+	{
+		return { DriveAction{ { MotorAction::MoveVoltage, 0,
+					(float)drive_voltage_left },
+				      { MotorAction::MoveVoltage, 0,
+					(float)drive_voltage_right },
+				      1 },
+			 (float)timeout_ms };
+	}
+
+	/*
+	 * Drives along a polyline with pure pursuit, steering towards the
+	 * point lookahead_in further along it. reversed drives it backwards.
+	 * Slows down over the last lookahead_in and finishes within
+	 * PATH_END_RANGE of the last point.
+	 */
+	template <size_t N>
+	static constexpr AutoStep follow_path(const PathPoint (&points)[N],
+					      double max_voltage,
+					      double timeout_ms,
+					      double lookahead_in = 12.0,
+					      bool reversed = false)
+	{
+		static_assert(N >= 2, "a path needs at least two points");
+		return { FollowPath{ points, (uint16_t)N, (float)lookahead_in,
+				     (float)max_voltage, reversed },
+			 (float)timeout_ms };
+	}
+
+	/*
+	 * Tracks a trajectory in time with RAMSETE, correcting towards where
+	 * the robot should be at each moment from the odometry pose. Finishes
+	 * once the trajectory's time is up.
+	 */
+	template <size_t N>
+	static constexpr AutoStep
+	follow_trajectory(const TrajectoryPoint (&points)[N], double timeout_ms)
+	{
+		return follow_trajectory(points, N, timeout_ms);
+	}
+
+	static constexpr AutoStep
+	follow_trajectory(const TrajectoryPoint *points, size_t num_points,
+			  double timeout_ms)
+	{
+		return { FollowTrajectory{ points, (uint16_t)num_points },
+			 (float)timeout_ms };
+	}
+
+	/*
+	 * Drives to (x, y) and arrives facing heading in one curve, steering at
+	 * a carrot point that is pulled back from the target along heading and
+	 * slides onto it as the robot closes in. A higher lead swings wider.
+	 * Finishes once the robot is within MOVE_TO_POSE_END_RANGE inches and
+	 * MOVE_TO_POSE_HEADING_RANGE degrees of the pose.
+	 */
+	static constexpr AutoStep
+	move_to_pose(double x, double y, double heading, double max_linear,
+		     double max_angular, double timeout_ms, double lead = 0.6,
+		     bool reversed = false)
+	{
+		return { MoveToPose{ (float)x, (float)y, (float)heading,
+				     (float)lead, (float)max_linear,
+				     (float)max_angular, reversed },
+			 (float)timeout_ms };
+	}
+
+	static constexpr AutoStep set_intake_extension(bool intake_extend,
+						       double rpm,
+						       double timeout_ms)
+	{
+		return { IntakeSetExtend{ (float)rpm, intake_extend },
+			 (float)timeout_ms };
+	}
+
+	static constexpr AutoStep set_intake_spin(double intake_spin_voltage,
+						  double timeout_ms)
+	{
+		return { IntakeSpin{ (float)intake_spin_voltage },
+			 (float)timeout_ms };
+	}
+
+	static constexpr AutoStep deploy_catapult()
+	{
+		return { DeployCatapult{}, 0 };
+	}
+
+	static constexpr AutoStep wait_for_catapult_deploy(double timeout_ms =
+								   10000)
+	{
+		return { WaitForCatapultDeploy{}, (float)timeout_ms };
+	}
+
+	// Drives the catapult until timeout_ms, unjamming it as a task so
+	// the other tracks keep running
+	static constexpr AutoStep fire_catapult_time(double timeout_ms,
+						     double voltage =
+							     MAX_VOLTAGE)
+	{
+		return { FireCatapultTime{ (float)voltage },
+			 (float)timeout_ms };
+	}
+
+	static constexpr AutoStep wait_for_catapult_engage()
+	{
+		return { WaitForCatapultEngage{}, 2500 };
+	}
+
+	static constexpr AutoStep wait_for_catapult_slip()
+	{
+		return { WaitForCatapultSlip{}, 2500 };
+	}
+
+	// Stops every track until func returns, so only for things that
+	// finish straight away. Anything longer should be a run_task().
+	static constexpr AutoStep
+	run_blocking_lambda(void (*func)(Timer &auto_timer))
+	{
+		return { RunBlockingLambda{ func }, 0 };
+	}
+
+	// Ticks func until it returns true. Timing out abandons the task
+	// wherever it is waiting.
+	static constexpr AutoStep run_task(AutoTaskFunc func,
+					   float timeout_ms = 10000000)
+	{
+		return { RunTask{ func }, timeout_ms };
+	}
+
+	// Waits until every track in join_tracks has reached this step
+	static constexpr AutoStep join(uint8_t join_tracks = AllTracks)
+	{
+		return AutoStep{ Join{}, 0 }.on(join_tracks);
+	}
+};
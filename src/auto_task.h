@@ -0,0 +1,70 @@
+#pragma once
+
+#include "timer.h"
+
+#include <cstdint>
+
+/*
+ * State of a cooperative autonomous task. A task is a function the sequencer
+ * calls once per tick, on the track of its step, until it returns true. It
+ * picks up from wherever it last waited using the AUTO_TASK_* macros below,
+ * so a long behavior can run next to the other tracks instead of owning the
+ * autonomous thread the way run_blocking_lambda() does.
+ *
+ * Locals don't survive a wait, so anything a task needs across one goes in
+ * stage and timer.
+ */
+struct AutoTask {
+	// Line of the wait the task is suspended at, 0 before it has started
+	uint32_t resume_line = 0;
+	// Free for the task to use
+	int stage = 0;
+	Timer timer;
+	// Used by AUTO_TASK_DELAY
+	Timer wait_timer;
+	Timer *auto_timer = nullptr;
+
+	double auto_clock_ms()
+	{
+		return auto_timer->GetElapsedTime().AsMilliseconds();
+	}
+};
+
+typedef bool (*AutoTaskFunc)(AutoTask &task);
+
+/*
+ * A task body goes between AUTO_TASK_BEGIN and AUTO_TASK_END. The waits jump
+ * back into the body with a switch, so no two can share a line and none can
+ * be placed after an initialized local in the same scope.
+ */
+#define AUTO_TASK_BEGIN(task)              \
+	switch ((task).resume_line) {      \
+	case 0:
+
+#define AUTO_TASK_END(task) \
+	}                   \
+	return true;
+
+// Gives up the rest of this tick
+#define AUTO_TASK_YIELD(task)                    \
+	do {                                     \
+		(task).resume_line = __LINE__;   \
+		return false;                    \
+	case __LINE__:;                          \
+	} while (0)
+
+// Gives up each tick until condition holds
+#define AUTO_TASK_AWAIT(task, condition)         \
+	do {                                     \
+		(task).resume_line = __LINE__;   \
+	case __LINE__:                           \
+		if (!(condition))                \
+			return false;            \
+	} while (0)
+
+#define AUTO_TASK_DELAY(task, ms)                                          \
+	do {                                                               \
+		(task).wait_timer.Restart();                               \
+		AUTO_TASK_AWAIT(task, (task).wait_timer.GetElapsedTime()   \
+					      .AsMilliseconds() >= (ms)); \
+	} while (0)
@@ -0,0 +1,105 @@
+#include "characterization.h"
+
+#include <cmath>
+
+void Characterization::clear()
+{
+	m_Samples.clear();
+	m_TestStart = 0;
+}
+
+void Characterization::begin_test()
+{
+	m_TestStart = m_Samples.size();
+}
+
+void Characterization::add(uint32_t time_ms, double voltage, double velocity)
+{
+	CharacterizationSample sample = { time_ms, (float)voltage,
+					  (float)velocity, 0.0f };
+	if (m_Samples.size() - m_TestStart >= CHARACTERIZATION_ACCEL_SAMPLES) {
+		const CharacterizationSample &earlier =
+			m_Samples[m_Samples.size() -
+				  CHARACTERIZATION_ACCEL_SAMPLES];
+		uint32_t elapsed_ms = sample.time_ms - earlier.time_ms;
+		if (elapsed_ms > 0)
+			sample.acceleration =
+				(sample.velocity - earlier.velocity) * 1000.0f /
+				elapsed_ms;
+	}
+	m_Samples.push_back(sample);
+}
+
+bool Characterization::fit(Feedforward &feedforward) const
+{
+	// Normal equations of voltage against sign(velocity), velocity and
+	// acceleration
+	double a[3][4] = {};
+	for (const CharacterizationSample &sample : m_Samples) {
+		if (std::fabs(sample.velocity) < CHARACTERIZATION_MIN_RPM)
+			continue;
+		double row[3] = { sample.velocity > 0.0f ? 1.0 : -1.0,
+				  sample.velocity, sample.acceleration };
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++)
+				a[i][j] += row[i] * row[j];
+			a[i][3] += row[i] * sample.voltage;
+		}
+	}
+
+	// Gaussian elimination with partial pivoting
+	for (int column = 0; column < 3; column++) {
+		int pivot = column;
+		for (int i = column + 1; i < 3; i++) {
+			if (std::fabs(a[i][column]) >
+			    std::fabs(a[pivot][column]))
+				pivot = i;
+		}
+		if (std::fabs(a[pivot][column]) < 1e-9)
+			return false;
+		for (int j = 0; j < 4; j++)
+			std::swap(a[column][j], a[pivot][j]);
+		for (int i = 0; i < 3; i++) {
+			if (i == column)
+				continue;
+			double factor = a[i][column] / a[column][column];
+			for (int j = column; j < 4; j++)
+				a[i][j] -= factor * a[column][j];
+		}
+	}
+
+	feedforward.ks = a[0][3] / a[0][0];
+	feedforward.kv = a[1][3] / a[1][1];
+	feedforward.ka = a[2][3] / a[2][2];
+	return true;
+}
+
+void Characterization::dump(FILE *file) const
+{
+	fprintf(file, "time_ms,voltage,velocity,acceleration\n");
+	for (const CharacterizationSample &sample : m_Samples) {
+		fprintf(file, "%lu,%.2f,%.2f,%.1f\n",
+			(unsigned long)sample.time_ms, sample.voltage,
+			sample.velocity, sample.acceleration);
+	}
+}
+
+size_t Characterization::num_samples() const
+{
+	return m_Samples.size();
+}
+
+uint32_t characterization_test_length_ms(CharacterizationTest test)
+{
+	if (test == CharacterizationTest::Quasistatic)
+		return CHARACTERIZATION_QUASISTATIC_MS;
+	return CHARACTERIZATION_STEP_MS;
+}
+
+double characterization_test_voltage(CharacterizationTest test,
+				     uint32_t elapsed_ms)
+{
+	if (test == CharacterizationTest::Quasistatic)
+		return CHARACTERIZATION_RAMP_PER_S * elapsed_ms / 1000.0;
+	return CHARACTERIZATION_STEP_VOLTAGE;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "motor_group.h"
+#include "sensor_frame.h"
+#include "pros/rtos.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/*
+ * Voltage a mechanism needs to move at a velocity and acceleration:
+ *
+ *	voltage = ks * sign(velocity) + kv * velocity + ka * acceleration
+ *
+ * in move() units (out of 127), RPM and RPM per second. The fitted constants
+ * are only reported, for copying into a controller's tuning by hand.
+ */
+struct Feedforward {
+	double ks;
+	double kv;
+	double ka;
+};
+
+struct CharacterizationSample {
+	uint32_t time_ms;
+	float voltage;
+	float velocity;
+	float acceleration;
+};
+
+enum class CharacterizationTest : uint8_t {
+	// Voltage ramped slowly enough that acceleration is negligible, which
+	// pins down ks and kv
+	Quasistatic,
+	// A fixed voltage from standstill, which mostly measures ka
+	Step,
+};
+
+// Quasistatic ramp rate and step voltage, in move() units
+#define CHARACTERIZATION_RAMP_PER_S 6.0
+#define CHARACTERIZATION_STEP_VOLTAGE 80.0
+#define CHARACTERIZATION_QUASISTATIC_MS 7000
+#define CHARACTERIZATION_STEP_MS 1500
+#define CHARACTERIZATION_SAMPLE_MS 5
+// Samples slower than this are left out of the fit, since ks only holds
+// once the mechanism is moving
+#define CHARACTERIZATION_MIN_RPM 2.0
+
+// Motor updates acceleration is differenced across. There is one sample per
+// update, so this spans 20 ms, the same as VELOCITY_WINDOW.
+#define CHARACTERIZATION_ACCEL_SAMPLES 2
+
+/*
+ * Samples of one motor group over every test run on it. Velocity is the
+ * group's average, estimated from the raw encoder timestamps, and
+ * acceleration is differenced from it.
+ */
+class Characterization {
+	public:
+	void clear();
+
+	// Call before each test so acceleration isn't taken across two tests
+	void begin_test();
+
+	// Takes a sample from a freshly sampled frame of the group, after it
+	// was driven at voltage since the last call. Frames that repeat the
+	// last motor update are skipped.
+	template <size_t N>
+	void sample(const MotorGroupFrame<N> &frame, double voltage)
+	{
+		if (m_Samples.size() > m_TestStart &&
+		    frame.reading_ms == m_Samples.back().time_ms)
+			return;
+		add(frame.reading_ms, voltage, frame.velocity);
+	}
+
+	// Least squares fit of every sample, returning false if the tests
+	// didn't move the group enough to fit all three terms
+	bool fit(Feedforward &feedforward) const;
+
+	// Writes every sample as CSV
+	void dump(FILE *file) const;
+
+	size_t num_samples() const;
+
+	private:
+	void add(uint32_t time_ms, double voltage, double velocity);
+
+	std::vector<CharacterizationSample> m_Samples;
+	// First sample of the running test
+	size_t m_TestStart = 0;
+};
+
+uint32_t characterization_test_length_ms(CharacterizationTest test);
+
+// Voltage a test drives with elapsed_ms in, before its direction is applied
+double characterization_test_voltage(CharacterizationTest test,
+				     uint32_t elapsed_ms);
+
+/*
+ * Runs one test on every group at once in direction (1 or -1), blocking
+ * until it ends. The groups are left braked.
+ */
+template <size_t N>
+void run_characterization_test(CharacterizationTest test, double direction,
+			       MotorGroup<N> *const *groups,
+			       Characterization *results, size_t num_groups)
+{
+	uint32_t length_ms = characterization_test_length_ms(test);
+	std::vector<MotorGroupFrame<N>> frames;
+	frames.reserve(num_groups);
+	for (size_t i = 0; i < num_groups; i++) {
+		frames.emplace_back(*groups[i]);
+		results[i].begin_test();
+	}
+
+	uint32_t start_ms = pros::c::millis();
+	uint32_t now = start_ms;
+	while (now - start_ms < length_ms) {
+		double voltage = direction * characterization_test_voltage(
+						     test, now - start_ms);
+		for (size_t i = 0; i < num_groups; i++)
+			groups[i]->move_voltage(voltage * 12000.0 / 127.0);
+		pros::c::task_delay_until(&now, CHARACTERIZATION_SAMPLE_MS);
+		for (size_t i = 0; i < num_groups; i++) {
+			frames[i].sample();
+			results[i].sample(frames[i], voltage);
+		}
+	}
+
+	for (size_t i = 0; i < num_groups; i++)
+		groups[i]->brake();
+}
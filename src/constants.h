@@ -0,0 +1,16 @@
+#pragma once
+
+// clang-format off
+
+#define MAX_VOLTAGE 127
+#define MAX_RPM 200
+
+#define INTAKE_EXTENDED_POSITION 170
+#define INTAKE_RETRACTED_POSITION 80
+
+#define DRIVE_UNITS_PER_INCH 27.46290005363848
+#define DRIVE_UNITS_PER_DEGREE 3.12
+// Distance between the wheels, from how far each side moves in a point turn
+#define DRIVE_TRACK_WIDTH_IN (2.0 * DRIVE_UNITS_PER_DEGREE / DRIVE_UNITS_PER_INCH * 180.0 / 3.14159265358979)
+// Raw encoder counts of a green cartridge are 900 a revolution
+#define DRIVE_DEGREES_PER_TICK (360.0 / 900.0)
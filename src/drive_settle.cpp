@@ -0,0 +1,23 @@
+#include "drive_settle.h"
+
+#include <cmath>
+
+void DriveSettle::reset()
+{
+	m_InRange = false;
+}
+
+bool DriveSettle::step(double error, double velocity, double range,
+		       double max_rpm)
+{
+	if (std::abs(error) > range || std::abs(velocity) > max_rpm) {
+		m_InRange = false;
+		return false;
+	}
+	if (!m_InRange) {
+		m_InRange = true;
+		m_Timer.Restart();
+	}
+	return m_Timer.GetElapsedTime().AsMilliseconds() >=
+	       DRIVE_SETTLE_TIME_MS;
+}
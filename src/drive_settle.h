@@ -0,0 +1,29 @@
+#pragma once
+
+#include "timer.h"
+
+// Default tolerances of a move_position() step, in drive units (encoder
+// degrees) from the target and RPM
+#define DRIVE_SETTLE_RANGE 6.0
+#define DRIVE_SETTLE_RPM 4.0
+// How long a side has to stay within both before the step is done
+#define DRIVE_SETTLE_TIME_MS 40
+
+/*
+ * Decides when one side of the drive has finished a move. Being near the
+ * target isn't enough on its own, since the drive can coast through it, and
+ * being stopped isn't either, since it can stall far short of it, so a side
+ * is only settled once it has been both for DRIVE_SETTLE_TIME_MS.
+ */
+class DriveSettle {
+	public:
+	void reset();
+
+	// Takes the side's averaged error and velocity this tick, returning
+	// whether it has settled
+	bool step(double error, double velocity, double range, double max_rpm);
+
+	private:
+	Timer m_Timer;
+	bool m_InRange = false;
+};
@@ -0,0 +1,145 @@
+#include "imu_sampler.h"
+
+#include "pros/error.h"
+#include "pros/imu.h"
+#include "pros/rtos.h"
+
+#include <cerrno>
+#include <cmath>
+
+ImuSampler::ImuSampler(uint8_t port) : m_Port(port)
+{
+}
+
+void ImuSampler::start()
+{
+	pros::c::imu_set_data_rate(m_Port, IMU_DATA_RATE_MS);
+	pros::c::task_create(task_entry, this, TASK_PRIORITY_DEFAULT + 2,
+			     TASK_STACK_DEPTH_DEFAULT, "IMU sampler");
+}
+
+void ImuSampler::calibrate()
+{
+	ImuCalibration expected = ImuCalibration::NotStarted;
+	if (m_Calibration.compare_exchange_strong(expected,
+						  ImuCalibration::Requested))
+		return;
+	expected = ImuCalibration::Ready;
+	m_Calibration.compare_exchange_strong(expected,
+					      ImuCalibration::Requested);
+}
+
+bool ImuSampler::is_calibrated() const
+{
+	return m_Calibration.load() == ImuCalibration::Ready;
+}
+
+void ImuSampler::task_entry(void *sampler)
+{
+	uint32_t now = pros::c::millis();
+	while (true) {
+		((ImuSampler *)sampler)->update();
+		pros::c::task_delay_until(&now, IMU_SAMPLE_PERIOD_MS);
+	}
+}
+
+void ImuSampler::update()
+{
+	if (m_Calibration.load() == ImuCalibration::Requested) {
+		// Only blocks until the IMU says it has started, at most 1 s
+		if (pros::c::imu_reset(m_Port) != PROS_ERR || errno == EAGAIN)
+			m_Calibration.store(ImuCalibration::Calibrating);
+		else
+			m_Calibration.store(ImuCalibration::NotStarted);
+	}
+
+	pros::c::imu_gyro_s_t gyro = pros::c::imu_get_gyro_rate(m_Port);
+	pros::c::imu_accel_s_t accel = pros::c::imu_get_accel(m_Port);
+
+	uint32_t written = m_Written.load(std::memory_order_relaxed);
+	ImuSample &sample = m_Samples[written % IMU_SAMPLE_BUFFER_SIZE];
+	sample.time_us = pros::c::micros();
+	sample.rotation = pros::c::imu_get_rotation(m_Port);
+	sample.gyro_rate = gyro.z;
+	sample.accel_x = accel.x;
+	sample.accel_y = accel.y;
+	sample.accel_z = accel.z;
+	sample.calibrating = (pros::c::imu_get_status(m_Port) &
+			      pros::c::E_IMU_STATUS_CALIBRATING) != 0;
+	if (m_Calibration.load() == ImuCalibration::Calibrating &&
+	    !sample.calibrating && std::isfinite(sample.rotation))
+		m_Calibration.store(ImuCalibration::Ready);
+	if (m_Calibration.load() != ImuCalibration::Ready)
+		sample.calibrating = true;
+	m_Written.store(written + 1, std::memory_order_release);
+}
+
+bool ImuSampler::read(uint32_t index, ImuSample &sample) const
+{
+	sample = m_Samples[index % IMU_SAMPLE_BUFFER_SIZE];
+	std::atomic_thread_fence(std::memory_order_acquire);
+	// The writer fills slot index again as sample index + size, so the
+	// copy is only safe if it hadn't started that by now
+	uint32_t written = m_Written.load(std::memory_order_relaxed);
+	return written - index < IMU_SAMPLE_BUFFER_SIZE;
+}
+
+bool ImuSampler::latest(ImuSample &sample) const
+{
+	while (true) {
+		uint32_t written = m_Written.load(std::memory_order_acquire);
+		if (written == 0)
+			return false;
+		if (read(written - 1, sample))
+			return true;
+	}
+}
+
+bool ImuSampler::sample_at(uint64_t time_us, ImuSample &sample) const
+{
+	uint32_t written = m_Written.load(std::memory_order_acquire);
+	if (written == 0)
+		return false;
+
+	ImuSample later;
+	if (!read(written - 1, later))
+		return latest(sample);
+	if (time_us >= later.time_us) {
+		sample = later;
+		return true;
+	}
+
+	// Walk back to the first sample at or before time_us, leaving one
+	// slot spare so the writer can't lap the walk
+	uint32_t oldest = written > IMU_SAMPLE_BUFFER_SIZE - 1 ?
+				  written - (IMU_SAMPLE_BUFFER_SIZE - 1) :
+				  0;
+	for (uint32_t i = written - 1; i > oldest; i--) {
+		ImuSample earlier;
+		if (!read(i - 1, earlier))
+			return false;
+		if (earlier.time_us > time_us) {
+			later = earlier;
+			continue;
+		}
+		if (earlier.calibrating || later.calibrating) {
+			sample = time_us - earlier.time_us <
+						 later.time_us - time_us ?
+					 earlier :
+					 later;
+			return true;
+		}
+		float along = (float)(time_us - earlier.time_us) /
+			      (float)(later.time_us - earlier.time_us);
+		sample = earlier;
+		sample.time_us = time_us;
+		sample.rotation += along * (later.rotation - earlier.rotation);
+		sample.gyro_rate +=
+			along * (later.gyro_rate - earlier.gyro_rate);
+		sample.accel_x += along * (later.accel_x - earlier.accel_x);
+		sample.accel_y += along * (later.accel_y - earlier.accel_y);
+		sample.accel_z += along * (later.accel_z - earlier.accel_z);
+		return true;
+	}
+	return false;
+}
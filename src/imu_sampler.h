@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// The IMU can refresh its data every 5 ms, twice its default rate, which
+// keeps each reading as recent as possible
+#define IMU_DATA_RATE_MS 5
+// PROS only copies device values into shared memory every 10 ms, so
+// sampling any faster would just read each value twice
+#define IMU_SAMPLE_PERIOD_MS 10
+// 160 ms of samples, so an interpolated read can reach back past a few
+// control ticks
+#define IMU_SAMPLE_BUFFER_SIZE 16
+
+struct ImuSample {
+	// pros::micros() when the sample was read
+	uint64_t time_us;
+	// Degrees clockwise, like imu.get_rotation()
+	float rotation;
+	// Degrees per second about the IMU's z axis
+	float gyro_rate;
+	// g along each of the IMU's axes
+	float accel_x;
+	float accel_y;
+	float accel_z;
+	// rotation isn't valid while this is set, which includes any time
+	// before the first calibration finishes
+	bool calibrating;
+};
+
+enum class ImuCalibration : uint8_t {
+	NotStarted,
+	Requested,
+	Calibrating,
+	Ready,
+};
+
+/*
+ * Reads the IMU on a task of its own as fast as it updates, into a ring
+ * buffer of the most recent samples. The task is the only writer; readers in
+ * any task never block it or each other, and retry the rare read the writer
+ * lapped.
+ *
+ * The task also runs the IMU's calibration, so starting one never blocks the
+ * caller. Until it finishes, samples are marked as calibrating and the
+ * odometry heading comes from the drive encoders.
+ */
+class ImuSampler {
+	public:
+	explicit ImuSampler(uint8_t port);
+
+	void start();
+
+	// Starts calibrating the IMU on the sampler task unless it already is.
+	// The robot has to stay still for the two or so seconds it takes.
+	void calibrate();
+
+	bool is_calibrated() const;
+
+	// Newest sample, or false if there hasn't been one yet
+	bool latest(ImuSample &sample) const;
+
+	// Sample interpolated to time_us, or the newest one if time_us is after
+	// it. Returns false if time_us is older than the buffer reaches.
+	bool sample_at(uint64_t time_us, ImuSample &sample) const;
+
+	private:
+	static void task_entry(void *sampler);
+
+	void update();
+
+	// Copies sample number index, returning false if the writer has
+	// overwritten it since
+	bool read(uint32_t index, ImuSample &sample) const;
+
+	uint8_t m_Port;
+	ImuSample m_Samples[IMU_SAMPLE_BUFFER_SIZE] = {};
+	// Number of samples ever written; sample n is in slot n % size
+	std::atomic<uint32_t> m_Written = 0;
+	std::atomic<ImuCalibration> m_Calibration = ImuCalibration::NotStarted;
+};
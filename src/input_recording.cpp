@@ -0,0 +1,151 @@
+#include "input_recording.h"
+
+#include <cstdio>
+
+#define HELD_TICKS_MAX 128
+#define CHANGE_FLAG 0x80
+#define CHANGE_LEFT (1 << 2)
+#define CHANGE_RIGHT (1 << 1)
+#define CHANGE_BUTTONS (1 << 0)
+
+void InputRecorder::clear()
+{
+	m_Stream.clear();
+	m_Stream.reserve(INPUT_RECORDING_RESERVE_BYTES);
+	m_Last = {};
+	m_HeldTicks = 0;
+	m_NumTicks = 0;
+}
+
+void InputRecorder::add(const DriverInput &input)
+{
+	m_NumTicks++;
+	uint8_t change = 0;
+	if (input.left_y != m_Last.left_y)
+		change |= CHANGE_LEFT;
+	if (input.right_y != m_Last.right_y)
+		change |= CHANGE_RIGHT;
+	if (input.buttons != m_Last.buttons)
+		change |= CHANGE_BUTTONS;
+
+	if (change == 0) {
+		m_HeldTicks++;
+		if (m_HeldTicks == HELD_TICKS_MAX)
+			flush_held_ticks();
+		return;
+	}
+
+	flush_held_ticks();
+	m_Stream.push_back(CHANGE_FLAG | change);
+	if (change & CHANGE_LEFT)
+		m_Stream.push_back((uint8_t)input.left_y);
+	if (change & CHANGE_RIGHT)
+		m_Stream.push_back((uint8_t)input.right_y);
+	if (change & CHANGE_BUTTONS) {
+		m_Stream.push_back(input.buttons & 0xFF);
+		m_Stream.push_back(input.buttons >> 8);
+	}
+	m_Last = input;
+}
+
+void InputRecorder::flush_held_ticks()
+{
+	if (m_HeldTicks == 0)
+		return;
+	m_Stream.push_back(m_HeldTicks - 1);
+	m_HeldTicks = 0;
+}
+
+bool InputRecorder::save(const char *path, uint16_t tick_ms)
+{
+	flush_held_ticks();
+
+	FILE *file = fopen(path, "wb");
+	if (file == nullptr)
+		return false;
+
+	InputRecordingHeader header = { INPUT_RECORDING_MAGIC,
+					INPUT_RECORDING_VERSION, tick_ms,
+					m_NumTicks,
+					(uint32_t)m_Stream.size() };
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		  fwrite(m_Stream.data(), 1, m_Stream.size(), file) ==
+			  m_Stream.size();
+	fclose(file);
+	return ok;
+}
+
+uint32_t InputRecorder::num_ticks() const
+{
+	return m_NumTicks;
+}
+
+bool InputPlayer::load(const char *path)
+{
+	m_Stream.clear();
+	m_Position = 0;
+	m_Current = {};
+	m_HeldTicks = 0;
+
+	FILE *file = fopen(path, "rb");
+	if (file == nullptr)
+		return false;
+
+	InputRecordingHeader header;
+	bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+		  header.magic == INPUT_RECORDING_MAGIC &&
+		  header.version == INPUT_RECORDING_VERSION &&
+		  header.tick_ms != 0;
+	if (ok) {
+		m_Stream.resize(header.num_bytes);
+		ok = fread(m_Stream.data(), 1, m_Stream.size(), file) ==
+		     m_Stream.size();
+		m_TickMs = header.tick_ms;
+	}
+	fclose(file);
+
+	if (!ok)
+		m_Stream.clear();
+	return ok;
+}
+
+bool InputPlayer::next(DriverInput &input)
+{
+	if (m_HeldTicks > 0) {
+		m_HeldTicks--;
+		input = m_Current;
+		return true;
+	}
+	if (m_Position >= m_Stream.size())
+		return false;
+
+	uint8_t code = m_Stream[m_Position++];
+	if (!(code & CHANGE_FLAG)) {
+		// This tick is the first of the held ones
+		m_HeldTicks = code;
+		input = m_Current;
+		return true;
+	}
+
+	size_t length = ((code & CHANGE_LEFT) ? 1 : 0) +
+			((code & CHANGE_RIGHT) ? 1 : 0) +
+			((code & CHANGE_BUTTONS) ? 2 : 0);
+	if (m_Stream.size() - m_Position < length)
+		return false;
+	if (code & CHANGE_LEFT)
+		m_Current.left_y = (int8_t)m_Stream[m_Position++];
+	if (code & CHANGE_RIGHT)
+		m_Current.right_y = (int8_t)m_Stream[m_Position++];
+	if (code & CHANGE_BUTTONS) {
+		m_Current.buttons = m_Stream[m_Position] |
+				    m_Stream[m_Position + 1] << 8;
+		m_Position += 2;
+	}
+	input = m_Current;
+	return true;
+}
+
+uint16_t InputPlayer::tick_ms() const
+{
+	return m_TickMs;
+}
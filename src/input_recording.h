@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Controller buttons driver control reads, as bits of DriverInput::buttons
+enum DriverButton : uint16_t {
+	ButtonR1 = 1 << 0,
+	ButtonR2 = 1 << 1,
+	ButtonL1 = 1 << 2,
+	ButtonL2 = 1 << 3,
+	ButtonUp = 1 << 4,
+	ButtonDown = 1 << 5,
+	ButtonLeft = 1 << 6,
+	ButtonRight = 1 << 7,
+	ButtonX = 1 << 8,
+	ButtonB = 1 << 9,
+};
+
+// Everything driver control reads from the controller in one tick
+struct DriverInput {
+	int8_t left_y;
+	int8_t right_y;
+	uint16_t buttons;
+
+	bool pressed(uint16_t button) const
+	{
+		return (buttons & button) != 0;
+	}
+};
+
+/*
+ * A recording is a header followed by one byte stream of ticks. Each tick is
+ * only stored as what changed since the last one:
+ *
+ *	0nnnnnnn		the last input held for another n + 1 ticks
+ *	10000lrb [l] [r] [bb]	a new input, followed by left_y (int8) if l is
+ *				set, right_y (int8) if r is set and buttons
+ *				(uint16) if b is set
+ *
+ * so a still controller costs a byte per 128 ticks and a busy one at most
+ * five bytes per tick.
+ */
+#define INPUT_RECORDING_MAGIC 0x4E495856 // "VXIN"
+#define INPUT_RECORDING_VERSION 1
+// Enough for 60 s of both sticks moving every 5 ms tick
+#define INPUT_RECORDING_RESERVE_BYTES 36000
+
+struct InputRecordingHeader {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t tick_ms;
+	uint32_t num_ticks;
+	uint32_t num_bytes;
+};
+
+static_assert(sizeof(InputRecordingHeader) == 16);
+
+/*
+ * Records driver control inputs for replaying in autonomous. A 60 s run at
+ * 5 ms a tick stays in RAM until save() writes it out.
+ */
+class InputRecorder {
+	public:
+	void clear();
+
+	// Appends the input read in the next tick
+	void add(const DriverInput &input);
+
+	// Writes the recording to a file, returning false if it couldn't
+	bool save(const char *path, uint16_t tick_ms);
+
+	uint32_t num_ticks() const;
+
+	private:
+	void flush_held_ticks();
+
+	std::vector<uint8_t> m_Stream;
+	DriverInput m_Last = {};
+	uint32_t m_HeldTicks = 0;
+	uint32_t m_NumTicks = 0;
+};
+
+class InputPlayer {
+	public:
+	// Reads a recording made by InputRecorder, returning false if the file
+	// can't be read or is not a valid recording
+	bool load(const char *path);
+
+	// Fills in the input for the next tick, or returns false at the end
+	bool next(DriverInput &input);
+
+	uint16_t tick_ms() const;
+
+	private:
+	std::vector<uint8_t> m_Stream;
+	size_t m_Position = 0;
+	DriverInput m_Current = {};
+	uint32_t m_HeldTicks = 0;
+	uint16_t m_TickMs = 0;
+};
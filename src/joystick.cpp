@@ -0,0 +1,23 @@
+#include "joystick.h"
+
+#include <algorithm>
+
+int SlewLimiter::step(int target)
+{
+	// Coming back towards zero, or past it, is never limited
+	if (m_Output >= 0 && target < m_Output)
+		m_Output = std::max(target, 0);
+	else if (m_Output <= 0 && target > m_Output)
+		m_Output = std::min(target, 0);
+
+	if (target > m_Output)
+		m_Output = std::min(target, m_Output + JOYSTICK_SLEW_PER_TICK);
+	else if (target < m_Output)
+		m_Output = std::max(target, m_Output - JOYSTICK_SLEW_PER_TICK);
+	return m_Output;
+}
+
+void SlewLimiter::reset()
+{
+	m_Output = 0;
+}
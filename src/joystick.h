@@ -0,0 +1,133 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+enum class JoystickCurve : uint8_t {
+	Linear,
+	Exponential,
+	Cubic,
+	Custom,
+	Count,
+};
+
+// Stick travel, out of 127, that is read as centered
+#define JOYSTICK_DEADBAND 5
+// Steepness of the exponential curve; higher keeps the low end finer
+#define JOYSTICK_EXPONENTIAL_STEEPNESS 3.0
+// Share of the cubic curve that is x^3 rather than x
+#define JOYSTICK_CUBIC_WEIGHT 0.7
+// Most the drive command can grow by each 5 ms driver tick, so full stick
+// from rest takes about 60 ms
+#define JOYSTICK_SLEW_PER_TICK 10
+
+struct JoystickCurvePoint {
+	uint8_t input;
+	uint8_t output;
+};
+
+// Stick travel past the deadband against drive output for the Custom curve,
+// joined by straight lines
+constexpr JoystickCurvePoint joystick_custom_points[] = {
+	{ 0, 0 }, { 40, 15 }, { 80, 45 }, { 110, 90 }, { 127, 127 },
+};
+
+// Drive output for every stick reading, indexed by the reading cast to
+// uint8_t
+typedef std::array<int8_t, 256> JoystickTable;
+
+namespace joystick_detail
+{
+constexpr double exp(double x)
+{
+	double term = 1.0;
+	double sum = 1.0;
+	for (int n = 1; n < 40; n++) {
+		term *= x / n;
+		sum += term;
+	}
+	return sum;
+}
+
+// Shapes stick travel past the deadband, from 0 to 1
+constexpr double shape(JoystickCurve curve, double travel)
+{
+	switch (curve) {
+	case JoystickCurve::Exponential:
+		return (exp(JOYSTICK_EXPONENTIAL_STEEPNESS * travel) - 1.0) /
+		       (exp(JOYSTICK_EXPONENTIAL_STEEPNESS) - 1.0);
+	case JoystickCurve::Cubic:
+		return JOYSTICK_CUBIC_WEIGHT * travel * travel * travel +
+		       (1.0 - JOYSTICK_CUBIC_WEIGHT) * travel;
+	case JoystickCurve::Custom: {
+		double input = travel * 127.0;
+		for (size_t i = 1; i < std::size(joystick_custom_points);
+		     i++) {
+			JoystickCurvePoint from = joystick_custom_points[i - 1];
+			JoystickCurvePoint to = joystick_custom_points[i];
+			if (input <= to.input) {
+				double along = (input - from.input) /
+					       (to.input - from.input);
+				return (from.output +
+					along * (to.output - from.output)) /
+				       127.0;
+			}
+		}
+		return 1.0;
+	}
+	default:
+		return travel;
+	}
+}
+
+constexpr JoystickTable make_table(JoystickCurve curve)
+{
+	JoystickTable table = {};
+	for (int i = 0; i < 256; i++) {
+		int input = (int8_t)i;
+		int magnitude = input < 0 ? -input : input;
+		if (magnitude > 127)
+			magnitude = 127;
+		int output = 0;
+		if (magnitude > JOYSTICK_DEADBAND) {
+			double travel =
+				(double)(magnitude - JOYSTICK_DEADBAND) /
+				(127 - JOYSTICK_DEADBAND);
+			output = (int)(shape(curve, travel) * 127.0 + 0.5);
+		}
+		table[i] = (int8_t)(input < 0 ? -output : output);
+	}
+	return table;
+}
+} // namespace joystick_detail
+
+// Every curve is worked out at compile time, so shaping a stick reading is
+// one lookup
+constexpr JoystickTable joystick_tables[] = {
+	joystick_detail::make_table(JoystickCurve::Linear),
+	joystick_detail::make_table(JoystickCurve::Exponential),
+	joystick_detail::make_table(JoystickCurve::Cubic),
+	joystick_detail::make_table(JoystickCurve::Custom),
+};
+
+static_assert(std::size(joystick_tables) == (size_t)JoystickCurve::Count);
+
+constexpr int8_t shape_joystick(JoystickCurve curve, int8_t input)
+{
+	return joystick_tables[(size_t)curve][(uint8_t)input];
+}
+
+/*
+ * Limits how fast a drive command can speed up. Slowing down goes through
+ * straight away so the drive still stops the moment the stick is let go.
+ */
+class SlewLimiter {
+	public:
+	int step(int target);
+
+	void reset();
+
+	private:
+	int m_Output = 0;
+};
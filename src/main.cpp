@@ -1,26 +1,41 @@
 #include "main.h"
 
+#include "auto_step.h"
+#include "characterization.h"
+#include "constants.h"
+#include "drive_settle.h"
+#include "imu_sampler.h"
+#include "input_recording.h"
+#include "motor_group.h"
+#include "joystick.h"
+#include "move_to_pose.h"
+#include "odometry.h"
 #include "ports.h"
-#include "pros/imu.hpp"
+#include "pure_pursuit.h"
+#include "ramsete.h"
+#include "routine_loader.h"
+#include "sensor_frame.h"
+#include "step_log.h"
+#include "turn_controller.h"
 #include "pros/misc.h"
 #include "pros/misc.hpp"
 #include "pros/motors.h"
 #include "pros/rtos.hpp"
 #include "timer.h"
 #include <algorithm>
-
-#define MAX_VOLTAGE 127
-#define MAX_RPM 200
+#include <cmath>
+#include <variant>
+#include <vector>
 
 pros::Controller ctrl(pros::E_CONTROLLER_MASTER);
 
-pros::Imu imu(IMU_PORT);
+ImuSampler imu_sampler(IMU_PORT);
 
-pros::Motor_Group left_drive_group(LEFT_DRIVE_PORTS);
-pros::Motor_Group right_drive_group(RIGHT_DRIVE_PORTS);
-pros::Motor_Group intake_extension_group(INTAKE_EXTENSION_PORTS);
-pros::Motor_Group intake_spin_group(INTAKE_SPIN_PORTS);
-pros::Motor_Group catapult_group(CATAPULT_DRIVE_PORTS);
+DriveMotorGroup left_drive_group(LEFT_DRIVE_PORTS);
+DriveMotorGroup right_drive_group(RIGHT_DRIVE_PORTS);
+IntakeExtensionMotorGroup intake_extension_group(INTAKE_EXTENSION_PORTS);
+IntakeSpinMotorGroup intake_spin_group(INTAKE_SPIN_PORTS);
+CatapultMotorGroup catapult_group(CATAPULT_DRIVE_PORTS);
 pros::ADIDigitalOut left_wing(LEFT_WING_PORT);
 pros::ADIDigitalOut right_wing(RIGHT_WING_PORT);
 
@@ -28,6 +43,12 @@ pros::Motor catapult_block(CATAPULT_STOPPER_PORT);
 
 pros::Motor climb_motor(CLIMB_MOTOR_PORT);
 
+Odometry odometry(left_drive_group, right_drive_group, imu_sampler);
+
+// Sensor readings of the current control tick
+SensorFrame sensors(left_drive_group, right_drive_group,
+		    intake_extension_group, intake_spin_group, catapult_group);
+
 enum class CatapultDeployStatus {
 	NotDeploying,
 	RemoveBlock,
@@ -42,6 +63,19 @@ CatapultDeployStatus catapult_deploy_status =
 	CatapultDeployStatus::NotDeploying;
 Timer deploy_timer = Timer();
 
+// Task running AutonomousSequence::run_auto(), or nullptr when none is
+pros::task_t auto_sequence_task = nullptr;
+
+/*
+ * Wakes the autonomous sequencer early so it re-checks its steps straight
+ * away. Call this whenever something a step may be waiting on changes.
+ */
+void notify_auto_sequence()
+{
+	if (auto_sequence_task != nullptr)
+		pros::c::task_notify(auto_sequence_task);
+}
+
 /**
  * A callback function for LLEMU's center button.
  */
@@ -53,6 +87,7 @@ void on_center_button()
 
 void handle_catapult_deploy()
 {
+	CatapultDeployStatus previous_status = catapult_deploy_status;
 	switch (catapult_deploy_status) {
 	case CatapultDeployStatus::NotDeploying:
 		break;
@@ -69,7 +104,7 @@ void handle_catapult_deploy()
 		catapult_group.move(-75);
 		if (deploy_timer.GetElapsedTime().AsMilliseconds() < 100)
 			break;
-		if (catapult_group.get_actual_velocities()[0] > -10.0 ||
+		if (sensors.catapult.velocities[0] > -10.0 ||
 		    deploy_timer.GetElapsedTime().AsSeconds() > 8.0) {
 			catapult_deploy_status =
 				CatapultDeployStatus::PullBackFirst;
@@ -79,7 +114,7 @@ void handle_catapult_deploy()
 		break;
 	case CatapultDeployStatus::PullBackFirst:
 		catapult_group.move_absolute(1300, MAX_RPM);
-		if (catapult_group.get_positions()[0] >= 1300 ||
+		if (sensors.catapult.positions[0] >= 1300 ||
 		    deploy_timer.GetElapsedTime().AsSeconds() > 10.0) {
 			catapult_deploy_status =
 				CatapultDeployStatus::PlaceBlock;
@@ -96,7 +131,7 @@ void handle_catapult_deploy()
 		break;
 	case CatapultDeployStatus::PullBackSecond:
 		catapult_group.move_absolute(1500, MAX_RPM);
-		if (catapult_group.get_positions()[0] >= 1500 ||
+		if (sensors.catapult.positions[0] >= 1500 ||
 		    deploy_timer.GetElapsedTime().AsSeconds() > 2.0) {
 			catapult_deploy_status =
 				CatapultDeployStatus::NotDeploying;
@@ -105,6 +140,8 @@ void handle_catapult_deploy()
 		}
 		break;
 	}
+	if (catapult_deploy_status != previous_status)
+		notify_auto_sequence();
 }
 
 void set_deploy_catapult()
@@ -114,9 +151,8 @@ void set_deploy_catapult()
 }
 
 bool has_intake_homed = false;
-bool has_imu_been_set = false;
 
-void initCommon(bool init_imu)
+void initCommon()
 {
 	pros::lcd::initialize();
 
@@ -155,10 +191,6 @@ void initCommon(bool init_imu)
 	climb_motor.set_brake_mode(pros::E_MOTOR_BRAKE_HOLD);
 	climb_motor.brake();
 
-	if (init_imu && !has_imu_been_set) {
-		imu.reset();
-	}
-
 	if (!has_intake_homed) {
 		has_intake_homed = true;
 		intake_extension_group.move(-50);
@@ -167,12 +199,6 @@ void initCommon(bool init_imu)
 		pros::delay(10);
 		intake_extension_group.move(0);
 	}
-
-	if (init_imu && !has_imu_been_set) {
-		while (imu.is_calibrating())
-			pros::delay(5);
-		has_imu_been_set = true;
-	}
 }
 
 /**
@@ -183,6 +209,11 @@ void initCommon(bool init_imu)
  */
 void initialize()
 {
+	imu_sampler.start();
+	// Calibrates in the background while the robot sits before the match.
+	// Odometry, and the turns that use it, go by the encoders until then.
+	imu_sampler.calibrate();
+	odometry.start();
 }
 
 /**
@@ -192,25 +223,13 @@ void initialize()
  */
 void disabled()
 {
+	auto_sequence_task = nullptr;
 	left_drive_group = 0;
 	right_drive_group = 0;
 	intake_extension_group = 0;
 	intake_spin_group = 0;
 }
 
-/**
- * Runs after initialize(), and before autonomous when connected to the Field
- * Management System or the VEX Competition Switch. This is intended for
- * competition-specific initialization routines, such as an autonomous selector
- * on the LCD.
- *
- * This task will exit when the robot is enabled and autonomous or opcontrol
- * starts.
- */
-void competition_initialize()
-{
-}
-
 double double_abs(double i)
 {
 	if (i < 0.0) {
@@ -219,778 +238,1116 @@ double double_abs(double i)
 	return i;
 }
 
-#define INTAKE_EXTENDED_POSITION 170
-#define INTAKE_RETRACTED_POSITION 80
-
-#define DRIVE_UNITS_PER_INCH 27.46290005363848
-#define DRIVE_UNITS_PER_DEGREE 3.12
-
-enum class AutoActionType {
-	WaitUntilMatchTime,
-	ResetIMU,
-	TurnIMUFromStart,
-	DriveAction,
-	IntakeSetExtend,
-	IntakeSpin,
-	DeployCatapult,
-	WaitForCatapultDeploy,
-	FireCatapultTime,
-	WaitForCatapultEngage,
-	WaitForCatapultSlip,
-	RunBlockingLambda,
-};
+// How far the catapult is through its current shot, in encoder units
+static uint32_t catapult_slip_angle()
+{
+	return std::max((uint32_t)0,
+			(uint32_t)(sensors.catapult.positions[0] - 1500.0)) %
+	       1259;
+}
 
-enum class MotorAction {
-	MoveVoltage,
-	MoveAbsolute,
-	Brake,
-};
+// Whether the catapult has stopped stalling, or has stalled for long enough
+// since the task's wait_timer was restarted that it needs unjamming
+static bool catapult_stall_resolved(AutoTask &task)
+{
+	return sensors.catapult.currents[0] < 1750 ||
+	       task.wait_timer.GetElapsedTime().AsMilliseconds() >= 500;
+}
 
-enum class Direction {
-	Clockwise,
-	CounterClockwise,
-};
+/*
+ * Cycles the catapult until the autonomous clock reaches stop_ms, unjamming it
+ * whenever it stalls, then backs it off. Runs as a task so the other tracks
+ * keep going while it fires.
+ */
+static bool fire_catapult_until(AutoTask &task, double stop_ms)
+{
+	AUTO_TASK_BEGIN(task);
+	catapult_block.brake();
 
-struct AutoStep {
-	AutoActionType action_type;
-	uint32_t delay_ms_after_done = 0;
+	task.stage = 1;
+	while (true) {
+		if (task.stage == 1) {
+			catapult_group.move(MAX_VOLTAGE);
+			if (catapult_slip_angle() >= 1100) {
+				task.timer.Restart();
+				task.stage += 1;
+				continue;
+			}
+		} else if (task.stage == 2) {
+			catapult_group.brake();
+			if (task.timer.GetElapsedTime().AsMilliseconds() >
+			    150) {
+				task.stage += 1;
+				continue;
+			}
+		} else if (task.stage == 3) {
+			catapult_group.move(MAX_VOLTAGE);
+			if (catapult_slip_angle() < 100) {
+				task.stage = 1;
+				continue;
+			}
+		}
 
-	double imu_degree_target;
-	double imu_turn_half_offset;
-	double imu_turn_target_range;
-	Direction imu_turn_direction;
+		// Timer starts when auto starts
+		if (task.auto_clock_ms() >= stop_ms)
+			break;
 
-	MotorAction left_drive_action;
-	double left_drive_target;
-	double left_drive_speed;
-	MotorAction right_drive_action;
-	double right_drive_target;
-	double right_drive_speed;
+		if (sensors.catapult.currents[0] > 1750) {
+			// Only unjam if it stays stalled for 500 ms
+			task.wait_timer.Restart();
+			AUTO_TASK_AWAIT(task, catapult_stall_resolved(task));
+			if (sensors.catapult.currents[0] >= 1750) {
+				catapult_group.move(-MAX_VOLTAGE);
+				AUTO_TASK_DELAY(task, 650);
+				catapult_group.move(0);
+				AUTO_TASK_DELAY(task, 500);
+			}
+		}
 
-	bool intake_extend;
-	double intake_extend_speed;
-	MotorAction intake_spin_action;
-	double intake_spin_speed;
+		AUTO_TASK_YIELD(task);
+	}
+	catapult_group.move(-MAX_VOLTAGE);
+	AUTO_TASK_DELAY(task, 500);
+	catapult_group.move(0);
+	AUTO_TASK_END(task);
+}
 
-	MotorAction catapult_fire_action;
-	double catapult_fire_speed;
+bool fire_catapult_match(AutoTask &task)
+{
+	return fire_catapult_until(task, 28000);
+}
 
-	uint32_t required_num_to_procede = 1;
-	double timeout_ms;
+bool fire_catapult_skills(AutoTask &task)
+{
+	return fire_catapult_until(task, 49000);
+}
 
-	double wait_until_clock_time;
+/*
+ * Drives the catapult at voltage, backing it off whenever it stays stalled,
+ * until the step times out. The unjam is the same as fire_catapult_until()'s,
+ * with a longer rest after it.
+ */
+static bool fire_catapult_at(AutoTask &task, double voltage)
+{
+	AUTO_TASK_BEGIN(task);
+	while (true) {
+		catapult_group.move(voltage);
+		if (sensors.catapult.currents[0] > 1750) {
+			// Only unjam if it stays stalled for 500 ms
+			task.wait_timer.Restart();
+			AUTO_TASK_AWAIT(task, catapult_stall_resolved(task));
+			if (sensors.catapult.currents[0] >= 1750) {
+				catapult_group.move(-MAX_VOLTAGE);
+				AUTO_TASK_DELAY(task, 650);
+				catapult_group.move(0);
+				AUTO_TASK_DELAY(task, 1000);
+			}
+		}
+		AUTO_TASK_YIELD(task);
+	}
+	AUTO_TASK_END(task);
+}
 
-	std::function<void(Timer &)> lambda;
-};
+// Period sensor-driven steps are re-checked at. Steps that only wait for a
+// deadline sleep until it instead.
+#define AUTO_TICK_MS 5
+#define AUTO_MAX_SLEEP_MS 1000
+// Autonomous lengths the step scheduler plans against
+#define MATCH_AUTO_LENGTH_MS 45000
+#define SKILLS_AUTO_LENGTH_MS 60000
+// Gains of move_straight() steps, in RPM per drive unit of distance left and
+// RPM per degree off the starting heading
+#define STRAIGHT_DRIVE_KP 2.0
+#define HEADING_HOLD_KP 6.0
 
 class AutonomousSequence {
 	private:
+	enum class StepPhase : uint8_t {
+		NotStarted,
+		Running,
+		Settling,
+	};
+
+	struct TrackState {
+		size_t cursor;
+		StepPhase phase;
+		Timer step_timer;
+		uint32_t start_ms;
+		float timeout_ms;
+		AutoTask task;
+	};
+
 	std::vector<AutoStep> autonomous_steps;
 	Timer auto_timer;
+	TrackState tracks[NUM_AUTO_TRACKS];
+
+	// Length of autonomous the steps are scheduled against, 0 to run
+	// every step in full regardless of the clock
+	uint32_t match_length_ms = 0;
+
+	StepLog step_log;
+	// Remaining error of the step being ticked, filled in by tick_action
+	float step_errors[2];
+	// State of the RunTask or FireCatapultTime step being ticked
+	AutoTask *step_task = nullptr;
+	// Path segment the running FollowPath step has reached
+	size_t path_segment = 0;
+	// Progress of the running FollowTrajectory step
+	size_t trajectory_index = 0;
+	Timer trajectory_timer;
+	// Whether the running MoveToPose step is squaring up to its target
+	bool move_to_pose_close = false;
+	TurnController turn_controller;
+	DriveSettle left_drive_settle;
+	DriveSettle right_drive_settle;
+	// Heading the running move_straight() step holds
+	double hold_heading_target = 0.0;
+
+	bool drive_chain_pending = false;
+	double left_drive_offset = 0.0;
+	double right_drive_offset = 0.0;
+
+	// Each tick_action overload runs one 5 ms pass of its step and returns
+	// how many of the step's completion conditions are currently met.
+	uint32_t tick_action(const WaitUntilMatchTime &action)
+	{
+		if (auto_timer.GetElapsedTime().AsSeconds() >=
+		    action.clock_time_s)
+			return 1;
+		return 0;
+	}
 
-	public:
-	void start_timer()
+	uint32_t tick_action(const ResetIMU &action)
 	{
-		auto_timer.Restart();
+		if (imu_sampler.is_calibrated())
+			return 1;
+		return 0;
 	}
 
-	void wait_until_match_time(double time_s)
+	uint32_t tick_action(const WaitForIMU &action)
 	{
-		AutoStep new_action;
+		if (imu_sampler.is_calibrated())
+			return 1;
+		return 0;
+	}
 
-		new_action.action_type = AutoActionType::WaitUntilMatchTime;
-		new_action.wait_until_clock_time = time_s;
-		new_action.timeout_ms = 10000000;
+	uint32_t tick_action(const TurnIMUFromStart &action)
+	{
+		// The IMU heading once it has calibrated, the encoders' before
+		double current_angle = sensors.pose.heading;
+		double output = turn_controller.step(
+			action.degree_target - current_angle,
+			sensors.pose.time_ms);
+		double left_limit = action.left_drive_voltage;
+		double right_limit = action.right_drive_voltage;
+		left_drive_group.set_brake_modes(pros::E_MOTOR_BRAKE_HOLD);
+		right_drive_group.set_brake_modes(pros::E_MOTOR_BRAKE_HOLD);
+		if (left_limit == 0)
+			left_drive_group.brake();
+		else
+			left_drive_group.move(
+				std::clamp(output, -left_limit, left_limit));
+		if (right_limit == 0)
+			right_drive_group.brake();
+		else
+			right_drive_group.move(
+				-std::clamp(output, -right_limit, right_limit));
+
+		step_errors[0] = current_angle - action.degree_target;
+		if (turn_controller.is_settled())
+			return 1;
+		return 0;
+	}
 
-		autonomous_steps.push_back(new_action);
+	// Tolerances a drive step settles within, falling back to the defaults
+	static double settle_range(const DriveAction &action)
+	{
+		return action.settle_range > 0.0f ? action.settle_range :
+						    DRIVE_SETTLE_RANGE;
 	}
 
-	void reset_imu(double timeout_ms, bool blocking = false)
+	static double settle_rpm(const DriveAction &action)
 	{
-		AutoStep new_action;
+		return action.settle_rpm > 0.0f ? action.settle_rpm :
+						  DRIVE_SETTLE_RPM;
+	}
 
-		new_action.action_type = AutoActionType::ResetIMU;
-		new_action.timeout_ms = timeout_ms;
+	static uint32_t tick_drive_side(DriveMotorGroup &group,
+					const DriveGroupFrame &frame,
+					const DriveSide &side, double offset,
+					const DriveAction &action,
+					DriveSettle &settle, float &error)
+	{
+		switch (side.action) {
+		case MotorAction::MoveVoltage:
+			group.move(side.speed);
+			break;
+		case MotorAction::MoveAbsolute: {
+			double target = offset + side.target;
+			double position = frame.position;
+			error = target - position;
+			if (action.chained) {
+				// Keep full speed through the target so the
+				// next step starts already moving
+				double direction = side.target < 0 ? -1.0 : 1.0;
+				group.move_velocity(direction * side.speed);
+				if ((target - position) * direction <= 0.0)
+					return 1;
+				break;
+			}
+			group.move_absolute(target, side.speed);
 
-		autonomous_steps.push_back(new_action);
+			if (settle.step(error, frame.velocity,
+					settle_range(action),
+					settle_rpm(action)))
+				return 1;
+			break;
+		}
+		case MotorAction::Brake:
+			group.brake();
+			break;
+		}
+		return 0;
 	}
 
-	void turn_imu(Direction direction, double degrees, double drive_voltage,
-		      double timeout_ms, uint32_t delay_ms_after_done = 5,
-		      double turn_target_range = 2.0,
-		      double imu_turn_half_offset = 5.0)
+	// Drives both sides at the speed the distance left calls for, steering
+	// back to the starting heading with the difference between them
+	uint32_t tick_straight_drive(const DriveAction &action)
 	{
-		turn_imu_separate(direction, degrees, drive_voltage,
-				  drive_voltage, timeout_ms,
-				  delay_ms_after_done, turn_target_range,
-				  imu_turn_half_offset);
+		double left_error = left_drive_offset + action.left.target -
+				    sensors.left_drive.position;
+		double right_error = right_drive_offset + action.right.target -
+				     sensors.right_drive.position;
+		double error = (left_error + right_error) / 2.0;
+		double speed = action.left.speed;
+		double velocity;
+		uint32_t done = 0;
+		if (action.chained) {
+			double direction = action.left.target < 0 ? -1.0 : 1.0;
+			velocity = direction * speed;
+			if (error * direction <= 0.0)
+				done = 2;
+		} else {
+			velocity = std::clamp(error * STRAIGHT_DRIVE_KP, -speed,
+					      speed);
+			double measured_velocity =
+				(sensors.left_drive.velocity +
+				 sensors.right_drive.velocity) /
+				2.0;
+			if (left_drive_settle.step(error, measured_velocity,
+						   settle_range(action),
+						   settle_rpm(action)))
+				done = 2;
+		}
+
+		double heading_error =
+			hold_heading_target - sensors.pose.heading;
+		double trim = heading_error * HEADING_HOLD_KP;
+		left_drive_group.move_velocity(velocity + trim);
+		right_drive_group.move_velocity(velocity - trim);
+
+		step_errors[0] = error;
+		step_errors[1] = heading_error;
+		return done;
 	}
 
-	void turn_imu_separate(Direction direction, double degrees,
-			       double left_drive_voltage,
-			       double right_drive_voltage, double timeout_ms,
-			       uint32_t delay_ms_after_done = 5,
-			       double turn_target_range = 2.0,
-			       double imu_turn_half_offset = 5.0)
+	uint32_t tick_action(const DriveAction &action)
 	{
-		AutoStep new_action;
+		if (action.hold_heading)
+			return tick_straight_drive(action);
+		return tick_drive_side(left_drive_group, sensors.left_drive,
+				       action.left, left_drive_offset, action,
+				       left_drive_settle, step_errors[0]) +
+		       tick_drive_side(right_drive_group, sensors.right_drive,
+				       action.right, right_drive_offset, action,
+				       right_drive_settle, step_errors[1]);
+	}
 
-		new_action.delay_ms_after_done = delay_ms_after_done;
+	uint32_t tick_action(const FollowPath &action)
+	{
+		PursuitCommand command =
+			pure_pursuit(sensors.pose, action, path_segment);
+		left_drive_group.move(command.left);
+		right_drive_group.move(command.right);
+
+		step_errors[0] = command.distance_to_end;
+		if (command.distance_to_end <= PATH_END_RANGE)
+			return 1;
+		return 0;
+	}
 
-		new_action.action_type = AutoActionType::TurnIMUFromStart;
-		new_action.imu_degree_target = degrees;
-		new_action.imu_turn_direction = direction;
-		new_action.imu_turn_half_offset = imu_turn_half_offset;
-		new_action.imu_turn_target_range = turn_target_range;
+	uint32_t tick_action(const FollowTrajectory &action)
+	{
+		RamseteCommand command = ramsete(
+			sensors.pose, action,
+			trajectory_timer.GetElapsedTime().AsSeconds(),
+			trajectory_index);
+		left_drive_group.move_velocity(command.left_rpm);
+		right_drive_group.move_velocity(command.right_rpm);
+
+		step_errors[0] = command.error;
+		if (command.finished)
+			return 1;
+		return 0;
+	}
 
-		new_action.left_drive_action = MotorAction::MoveVoltage;
-		new_action.left_drive_speed = left_drive_voltage;
-		new_action.right_drive_action = MotorAction::MoveVoltage;
-		new_action.right_drive_speed = right_drive_voltage;
+	uint32_t tick_action(const MoveToPose &action)
+	{
+		MoveToPoseCommand command = move_to_pose(
+			sensors.pose, action, move_to_pose_close);
+		left_drive_group.move(command.left);
+		right_drive_group.move(command.right);
+
+		step_errors[0] = command.distance;
+		step_errors[1] = command.heading_error;
+		if (command.distance <= MOVE_TO_POSE_END_RANGE &&
+		    std::abs(command.heading_error) <=
+			    MOVE_TO_POSE_HEADING_RANGE)
+			return 1;
+		return 0;
+	}
 
-		new_action.timeout_ms = timeout_ms;
+	uint32_t tick_action(const IntakeSetExtend &action)
+	{
+		if (action.extend) {
+			intake_extension_group.move_absolute(
+				INTAKE_EXTENDED_POSITION, action.rpm);
+		} else {
+			intake_extension_group.move_absolute(
+				INTAKE_RETRACTED_POSITION, action.rpm);
+		}
+		return 0;
+	}
 
-		autonomous_steps.push_back(new_action);
+	uint32_t tick_action(const IntakeSpin &action)
+	{
+		intake_spin_group.move(action.voltage);
+		return 0;
 	}
 
-	void move_position(double drive_target, double drive_rpm,
-			   double timeout_ms)
+	uint32_t tick_action(const DeployCatapult &action)
 	{
-		move_position(drive_target, drive_target, drive_rpm, drive_rpm,
-			      timeout_ms);
+		catapult_deployed_in_auto = true;
+		set_deploy_catapult();
+		return 0;
 	}
 
-	void move_position(
-		double left_drive_target, double right_drive_target,
-		double left_drive_rpm, double right_drive_rpm,
-		double timeout_ms,
-		MotorAction left_drive_action = MotorAction::MoveAbsolute,
-		MotorAction right_drive_action = MotorAction::MoveAbsolute)
+	uint32_t tick_action(const WaitForCatapultDeploy &action)
 	{
-		AutoStep new_action;
+		if (catapult_deploy_status ==
+		    CatapultDeployStatus::NotDeploying)
+			return 1;
+		return 0;
+	}
 
-		new_action.action_type = AutoActionType::DriveAction;
-		new_action.left_drive_action = left_drive_action;
-		new_action.left_drive_target = left_drive_target;
-		new_action.left_drive_speed = left_drive_rpm;
-		new_action.right_drive_action = right_drive_action;
-		new_action.right_drive_target = right_drive_target;
-		new_action.right_drive_speed = right_drive_rpm;
+	uint32_t tick_action(const FireCatapultTime &action)
+	{
+		// Only ends by timing out
+		fire_catapult_at(*step_task, action.voltage);
+		return 0;
+	}
 
-		new_action.required_num_to_procede = 2;
-		new_action.timeout_ms = timeout_ms;
+	uint32_t tick_action(const WaitForCatapultEngage &action)
+	{
+		catapult_group.move(MAX_VOLTAGE);
+		catapult_block.brake();
+		if (sensors.catapult.currents[0] > 500)
+			return 1;
+		return 0;
+	}
 
-		autonomous_steps.push_back(new_action);
+	uint32_t tick_action(const WaitForCatapultSlip &action)
+	{
+		catapult_group.move(MAX_VOLTAGE);
+		catapult_block.brake();
+		if (sensors.catapult.currents[0] < 300)
+			return 1;
+		return 0;
 	}
 
-	void drive_power(double drive_voltage, double timeout_ms)
+	uint32_t tick_action(const RunBlockingLambda &action)
 	{
-		AutoStep new_action;
+		action.func(auto_timer);
+		return 1;
+	}
 
-		new_action.action_type = AutoActionType::DriveAction;
-		new_action.left_drive_action = MotorAction::MoveVoltage;
-		new_action.left_drive_speed = drive_voltage;
-		new_action.right_drive_action = MotorAction::MoveVoltage;
-		new_action.right_drive_speed = drive_voltage;
+	uint32_t tick_action(const RunTask &action)
+	{
+		if (action.func(*step_task))
+			return 1;
+		return 0;
+	}
 
-		new_action.timeout_ms = timeout_ms;
+	uint32_t tick_action(const Join &action)
+	{
+		return 1;
+	}
 
-		autonomous_steps.push_back(new_action);
+	// Number of conditions tick_action must report before the step is done
+	static uint32_t required_num_to_procede(const AutoAction &action)
+	{
+		if (auto drive = std::get_if<DriveAction>(&action))
+			return drive->required_num_to_procede;
+		return 1;
 	}
 
-	void drive_power(double drive_voltage_left, double drive_voltage_right,
-			 double timeout_ms)
+	uint32_t auto_clock_ms()
 	{
-		AutoStep new_action;
+		return (uint32_t)auto_timer.GetElapsedTime().AsMilliseconds();
+	}
 
-		new_action.action_type = AutoActionType::DriveAction;
-		new_action.left_drive_action = MotorAction::MoveVoltage;
-		new_action.left_drive_speed = drive_voltage_left;
-		new_action.right_drive_action = MotorAction::MoveVoltage;
-		new_action.right_drive_speed = drive_voltage_right;
+	static size_t next_step_on_track(const AutoStep *steps,
+					 size_t num_steps, size_t from,
+					 size_t track)
+	{
+		while (from < num_steps && !(steps[from].tracks & (1 << track)))
+			from++;
+		return from;
+	}
 
-		new_action.timeout_ms = timeout_ms;
+	static size_t owner_track(uint8_t step_tracks)
+	{
+		for (size_t t = 0; t < NUM_AUTO_TRACKS; t++) {
+			if (step_tracks & (1 << t))
+				return t;
+		}
+		return NUM_AUTO_TRACKS;
+	}
 
-		autonomous_steps.push_back(new_action);
+	bool is_step_joined(const AutoStep &step, size_t index) const
+	{
+		for (size_t t = 0; t < NUM_AUTO_TRACKS; t++) {
+			if ((step.tracks & (1 << t)) &&
+			    tracks[t].cursor != index)
+				return false;
+		}
+		return true;
 	}
 
-	void set_intake_extension(bool intake_extend, double rpm,
-				  double timeout_ms)
+	// Runs one tick of a step, moving its tracks on once it has finished
+	// and its delay_ms_after_done has passed. Returns whether it did so.
+	bool tick_step(const AutoStep *steps, size_t num_steps, size_t index)
 	{
-		AutoStep new_action;
+		const AutoStep &step = steps[index];
+		TrackState &state = tracks[owner_track(step.tracks)];
+
+		if (state.phase == StepPhase::NotStarted) {
+			state.timeout_ms =
+				scheduled_timeout_ms(steps, num_steps, index);
+			if (state.timeout_ms < 0) {
+				uint32_t now_ms = auto_clock_ms();
+				step_log.add({ now_ms, now_ms, (uint16_t)index,
+					       (uint8_t)step.action.index(),
+					       StepExit::Skipped,
+					       { 0.0, 0.0 } });
+				advance_tracks(steps, num_steps, index);
+				return true;
+			}
+			if (step.tracks & DriveTrack)
+				start_drive_step(step.action);
+			start_action(step.action, state);
+			state.step_timer.Restart();
+			state.start_ms = auto_clock_ms();
+			state.phase = StepPhase::Running;
+		}
 
-		new_action.action_type = AutoActionType::IntakeSetExtend;
-		new_action.intake_extend = intake_extend;
-		new_action.intake_extend_speed = rpm;
-		new_action.timeout_ms = timeout_ms;
+		if (state.phase == StepPhase::Running) {
+			step_errors[0] = 0.0;
+			step_errors[1] = 0.0;
+			step_task = &state.task;
+			uint32_t num_ready_to_procede = std::visit(
+				[this](const auto &action) {
+					return tick_action(action);
+				},
+				step.action);
+			bool condition_met =
+				num_ready_to_procede >=
+				required_num_to_procede(step.action);
+			double elapsed_ms = state.step_timer.GetElapsedTime()
+						    .AsMilliseconds();
+			if (condition_met || elapsed_ms >= state.timeout_ms) {
+				StepExit exit_reason =
+					condition_met ? StepExit::Condition :
+							StepExit::Timeout;
+				if (std::holds_alternative<RunBlockingLambda>(
+					    step.action))
+					exit_reason = StepExit::Lambda;
+				step_log.add({ state.start_ms, auto_clock_ms(),
+					       (uint16_t)index,
+					       (uint8_t)step.action.index(),
+					       exit_reason,
+					       { step_errors[0],
+						 step_errors[1] } });
+				finish_action(step.action);
+				state.step_timer.Restart();
+				state.phase = StepPhase::Settling;
+			}
+		}
 
-		autonomous_steps.push_back(new_action);
+		if (state.phase == StepPhase::Settling &&
+		    state.step_timer.GetElapsedTime().AsMilliseconds() >=
+			    step.delay_ms_after_done) {
+			advance_tracks(steps, num_steps, index);
+			return true;
+		}
+		return false;
 	}
 
-	void set_intake_spin(double intake_spin_voltage, double timeout_ms)
+	// Moves every track of a step on to its next step
+	void advance_tracks(const AutoStep *steps, size_t num_steps,
+			    size_t index)
 	{
-		AutoStep new_action;
+		for (size_t t = 0; t < NUM_AUTO_TRACKS; t++) {
+			if (!(steps[index].tracks & (1 << t)))
+				continue;
+			tracks[t].cursor = next_step_on_track(
+				steps, num_steps, index + 1, t);
+			tracks[t].phase = StepPhase::NotStarted;
+		}
+	}
+
+	static float estimated_cost_ms(const AutoStep &step)
+	{
+		if (step.cost_ms != 0)
+			return step.cost_ms;
+		return step.timeout_ms + step.delay_ms_after_done;
+	}
 
-		new_action.action_type = AutoActionType::IntakeSpin;
-		new_action.intake_spin_action = MotorAction::MoveVoltage;
-		new_action.intake_spin_speed = intake_spin_voltage;
-		new_action.timeout_ms = timeout_ms;
+	// Timeout a step gets once the critical steps still to come on its
+	// tracks have had their cost set aside. Negative means skip the step.
+	float scheduled_timeout_ms(const AutoStep *steps, size_t num_steps,
+				   size_t index)
+	{
+		const AutoStep &step = steps[index];
+		if (match_length_ms == 0 ||
+		    step.priority == StepPriority::Critical)
+			return step.timeout_ms;
+
+		float budget_ms = (float)match_length_ms - auto_clock_ms();
+		for (size_t j = index + 1; j < num_steps; j++) {
+			if ((steps[j].tracks & step.tracks) &&
+			    steps[j].priority == StepPriority::Critical)
+				budget_ms -= estimated_cost_ms(steps[j]);
+		}
 
-		autonomous_steps.push_back(new_action);
+		if (step.priority == StepPriority::Optional &&
+		    estimated_cost_ms(step) > budget_ms)
+			return -1;
+		return std::min(step.timeout_ms, std::max(budget_ms, 0.0f));
 	}
 
-	void deploy_catapult()
+	// Whether a step finishes on a sensor reading, so it has to be checked
+	// every AUTO_TICK_MS rather than only at its deadline
+	static bool needs_polling(const AutoAction &action)
 	{
-		AutoStep new_action;
+		if (auto drive = std::get_if<DriveAction>(&action))
+			return drive->left.action ==
+				       MotorAction::MoveAbsolute ||
+			       drive->right.action == MotorAction::MoveAbsolute;
+		return !std::holds_alternative<WaitUntilMatchTime>(action) &&
+		       !std::holds_alternative<IntakeSetExtend>(action) &&
+		       !std::holds_alternative<IntakeSpin>(action) &&
+		       !std::holds_alternative<DeployCatapult>(action) &&
+		       !std::holds_alternative<Join>(action);
+	}
 
-		new_action.action_type = AutoActionType::DeployCatapult;
-		new_action.timeout_ms = 0;
+	// Milliseconds until an active step next needs to be ticked
+	double step_wake_ms(const AutoStep &step, TrackState &state)
+	{
+		double elapsed_ms =
+			state.step_timer.GetElapsedTime().AsMilliseconds();
+		if (state.phase == StepPhase::Settling)
+			return step.delay_ms_after_done - elapsed_ms;
+
+		double wake_ms = state.timeout_ms - elapsed_ms;
+		if (auto wait = std::get_if<WaitUntilMatchTime>(&step.action)) {
+			wake_ms = std::min(
+				wake_ms,
+				wait->clock_time_s * 1000.0 -
+					auto_timer.GetElapsedTime()
+						.AsMilliseconds());
+		}
+		if (needs_polling(step.action))
+			wake_ms = std::min(wake_ms, (double)AUTO_TICK_MS);
+		return wake_ms;
+	}
 
-		autonomous_steps.push_back(new_action);
+	// How long the sequencer can sleep before any active step, or the
+	// catapult deploy, needs to run again
+	uint32_t next_wake_ms(const AutoStep *steps, size_t num_steps)
+	{
+		double wake_ms = AUTO_MAX_SLEEP_MS;
+		if (catapult_deploy_status !=
+		    CatapultDeployStatus::NotDeploying)
+			wake_ms = AUTO_TICK_MS;
+		for (size_t t = 0; t < NUM_AUTO_TRACKS; t++) {
+			size_t i = tracks[t].cursor;
+			if (i >= num_steps ||
+			    owner_track(steps[i].tracks) != t ||
+			    !is_step_joined(steps[i], i))
+				continue;
+			wake_ms = std::min(wake_ms,
+					   step_wake_ms(steps[i], tracks[t]));
+		}
+		// Rounded up, since waking before a deadline just means going
+		// straight back to sleep for under a millisecond
+		if (wake_ms <= 0.0)
+			return 0;
+		return (uint32_t)std::max(std::ceil(wake_ms), 1.0);
 	}
 
-	void wait_for_catapult_deploy(double timeout_ms = 10000)
+	static bool uses_drive(const AutoAction &action)
 	{
-		AutoStep new_action;
+		return std::holds_alternative<DriveAction>(action) ||
+		       std::holds_alternative<FollowPath>(action) ||
+		       std::holds_alternative<FollowTrajectory>(action) ||
+		       std::holds_alternative<MoveToPose>(action) ||
+		       std::holds_alternative<TurnIMUFromStart>(action);
+	}
 
-		new_action.action_type = AutoActionType::WaitForCatapultDeploy;
-		new_action.timeout_ms = timeout_ms;
+	// Brakes and re-zeroes the drive before a step, unless the last drive
+	// step was chained into this one
+	void start_drive_step(const AutoAction &action)
+	{
+		if (drive_chain_pending) {
+			if (uses_drive(action))
+				drive_chain_pending = false;
+			return;
+		}
+		left_drive_group.brake();
+		right_drive_group.brake();
+		left_drive_group.tare_position();
+		right_drive_group.tare_position();
+		left_drive_offset = 0.0;
+		right_drive_offset = 0.0;
+		// The frame still holds the positions from before the tare
+		sensors.left_drive.sample();
+		sensors.right_drive.sample();
+	}
 
-		autonomous_steps.push_back(new_action);
+	// Encoder reading the next chained step measures its target from. This
+	// carries on from the last target rather than the measured position so
+	// errors don't build up along a chain.
+	static double chain_offset(const DriveGroupFrame &frame,
+				   const DriveSide &side, double offset)
+	{
+		if (side.action == MotorAction::MoveAbsolute)
+			return offset + side.target;
+		return frame.position;
 	}
 
-	void fire_catapult_time(double timeout_ms, double voltage = MAX_VOLTAGE)
+	// Called once when a step starts, before its first tick
+	void start_action(const AutoAction &action, TrackState &state)
 	{
-		AutoStep new_action;
+		if (std::holds_alternative<RunTask>(action) ||
+		    std::holds_alternative<FireCatapultTime>(action)) {
+			state.task = AutoTask();
+			state.task.auto_timer = &auto_timer;
+		} else if (std::holds_alternative<ResetIMU>(action)) {
+			imu_sampler.calibrate();
+		} else if (auto turn = std::get_if<TurnIMUFromStart>(&action)) {
+			turn_controller.reset(turn->target_range);
+		} else if (auto drive = std::get_if<DriveAction>(&action)) {
+			left_drive_settle.reset();
+			right_drive_settle.reset();
+			// Odometry's heading falls back to the encoders while
+			// the IMU is calibrating, so this holds either way
+			if (drive->hold_heading)
+				hold_heading_target =
+					sensors.pose.heading;
+		} else if (std::holds_alternative<FollowPath>(action)) {
+			path_segment = 0;
+		} else if (std::holds_alternative<FollowTrajectory>(action)) {
+			trajectory_index = 0;
+			trajectory_timer.Restart();
+		} else if (std::holds_alternative<MoveToPose>(action)) {
+			move_to_pose_close = false;
+		}
+	}
 
-		new_action.action_type = AutoActionType::FireCatapultTime;
-		new_action.timeout_ms = timeout_ms;
-		new_action.catapult_fire_speed = voltage;
+	// Called once when a step finishes, either by its condition or timeout
+	void finish_action(const AutoAction &action)
+	{
+		auto drive = std::get_if<DriveAction>(&action);
+		if (drive && drive->chained) {
+			left_drive_offset =
+				chain_offset(sensors.left_drive, drive->left,
+					     left_drive_offset);
+			right_drive_offset =
+				chain_offset(sensors.right_drive, drive->right,
+					     right_drive_offset);
+			drive_chain_pending = true;
+		} else if (std::holds_alternative<TurnIMUFromStart>(action) ||
+			   std::holds_alternative<FollowPath>(action) ||
+			   std::holds_alternative<FollowTrajectory>(action) ||
+			   std::holds_alternative<MoveToPose>(action)) {
+			left_drive_group.set_brake_modes(
+				pros::E_MOTOR_BRAKE_HOLD);
+			right_drive_group.set_brake_modes(
+				pros::E_MOTOR_BRAKE_HOLD);
+			left_drive_group.brake();
+			right_drive_group.brake();
+		} else if (std::holds_alternative<WaitForCatapultSlip>(
+				   action) ||
+			   std::holds_alternative<FireCatapultTime>(action)) {
+			catapult_group.brake();
+		}
+	}
 
-		autonomous_steps.push_back(new_action);
+	public:
+	void start_timer()
+	{
+		auto_timer.Restart();
 	}
 
-	void wait_for_catapult_engage()
+	void set_match_length_ms(uint32_t length_ms)
 	{
-		AutoStep new_action;
+		match_length_ms = length_ms;
+	}
 
-		new_action.action_type = AutoActionType::WaitForCatapultEngage;
-		new_action.required_num_to_procede = 1;
-		new_action.timeout_ms = 2500;
+	void add_step(const AutoStep &step)
+	{
+		autonomous_steps.push_back(step);
+	}
 
-		autonomous_steps.push_back(new_action);
+	void wait_until_match_time(double time_s)
+	{
+		autonomous_steps.push_back(
+			AutoStep::wait_until_match_time(time_s));
 	}
 
-	void wait_for_catapult_slip()
+	void reset_imu(double timeout_ms, bool blocking = false)
 	{
-		AutoStep new_action;
+		autonomous_steps.push_back(AutoStep::reset_imu(timeout_ms));
+	}
 
-		new_action.action_type = AutoActionType::WaitForCatapultSlip;
-		new_action.required_num_to_procede = 1;
-		new_action.timeout_ms = 2500;
+	void wait_for_imu(double timeout_ms = 3000)
+	{
+		autonomous_steps.push_back(AutoStep::wait_for_imu(timeout_ms));
+	}
 
-		autonomous_steps.push_back(new_action);
+	void turn_imu(Direction direction, double degrees, double drive_voltage,
+		      double timeout_ms, uint32_t delay_ms_after_done = 5,
+		      double turn_target_range = 2.0)
+	{
+		autonomous_steps.push_back(AutoStep::turn_imu(
+			direction, degrees, drive_voltage, timeout_ms,
+			delay_ms_after_done, turn_target_range));
 	}
 
-	void run_blocking_lambda(std::function<void(Timer &)> func)
+	void turn_imu_separate(Direction direction, double degrees,
+			       double left_drive_voltage,
+			       double right_drive_voltage, double timeout_ms,
+			       uint32_t delay_ms_after_done = 5,
+			       double turn_target_range = 2.0)
 	{
-		AutoStep new_action;
+		autonomous_steps.push_back(AutoStep::turn_imu_separate(
+			direction, degrees, left_drive_voltage,
+			right_drive_voltage, timeout_ms, delay_ms_after_done,
+			turn_target_range));
+	}
 
-		new_action.action_type = AutoActionType::RunBlockingLambda;
-		new_action.lambda = func;
+	void move_position(double drive_target, double drive_rpm,
+			   double timeout_ms)
+	{
+		autonomous_steps.push_back(AutoStep::move_position(
+			drive_target, drive_rpm, timeout_ms));
+	}
 
-		autonomous_steps.push_back(new_action);
+	void move_position(
+		double left_drive_target, double right_drive_target,
+		double left_drive_rpm, double right_drive_rpm,
+		double timeout_ms,
+		MotorAction left_drive_action = MotorAction::MoveAbsolute,
+		MotorAction right_drive_action = MotorAction::MoveAbsolute)
+	{
+		autonomous_steps.push_back(AutoStep::move_position(
+			left_drive_target, right_drive_target, left_drive_rpm,
+			right_drive_rpm, timeout_ms, left_drive_action,
+			right_drive_action));
 	}
 
-	void run_auto()
+	void drive_power(double drive_voltage, double timeout_ms)
 	{
-		double last_imu_rotation = 0.0;
+		autonomous_steps.push_back(
+			AutoStep::drive_power(drive_voltage, timeout_ms));
+	}
 
-		Timer auto_change_timer;
-		for (const auto &step : autonomous_steps) {
-			auto_change_timer.Restart();
-			left_drive_group.brake();
-			right_drive_group.brake();
-			left_drive_group.tare_position();
-			right_drive_group.tare_position();
-
-			while (true) {
-				handle_catapult_deploy();
-				uint32_t num_ready_to_procede = 0;
-				switch (step.action_type) {
-				case AutoActionType::WaitUntilMatchTime:
-					if (auto_timer.GetElapsedTime()
-						    .AsSeconds() >=
-					    step.wait_until_clock_time)
-						num_ready_to_procede += 1;
-				case AutoActionType::ResetIMU:
-					imu.reset();
-
-					if (!imu.is_calibrating())
-						num_ready_to_procede += 1;
-					break;
-				case AutoActionType::TurnIMUFromStart: {
-					double current_angle =
-						imu.get_rotation();
-					double mult =
-						(step.imu_turn_direction ==
-								 Direction::
-									 Clockwise ?
-							 1.0 :
-							 -1.0) *
-						(current_angle - step.imu_degree_target <
-								 step.imu_turn_half_offset ?
-							 0.5 :
-							 1.0);
-					left_drive_group.set_brake_modes(
-						pros::E_MOTOR_BRAKE_HOLD);
-					right_drive_group.set_brake_modes(
-						pros::E_MOTOR_BRAKE_HOLD);
-					if (step.left_drive_speed == 0)
-						left_drive_group.brake();
-					else
-						left_drive_group.move(
-							step.left_drive_speed *
-							mult);
-					if (step.right_drive_speed == 0)
-						right_drive_group.brake();
-					else
-						right_drive_group.move(
-							-step.right_drive_speed *
-							mult);
-
-					if (std::abs(current_angle -
-						     step.imu_degree_target) <
-					    step.imu_turn_target_range) {
-						num_ready_to_procede += 1;
-					}
-					break;
-				}
-				case AutoActionType::DriveAction:
-					switch (step.left_drive_action) {
-					case MotorAction::MoveVoltage:
-						left_drive_group.move(
-							step.left_drive_speed);
-						break;
-					case MotorAction::MoveAbsolute:
-						left_drive_group.move_absolute(
-							step.left_drive_target,
-							step.left_drive_speed);
-
-						if (double_abs(
-							    left_drive_group
-								    .get_positions()
-									    [0] -
-							    step.left_drive_target) <=
-						    1.0)
-							num_ready_to_procede +=
-								1;
-						break;
-					case MotorAction::Brake:
-						left_drive_group.brake();
-						break;
-					}
-					switch (step.right_drive_action) {
-					case MotorAction::MoveVoltage:
-						right_drive_group.move(
-							step.right_drive_speed);
-						break;
-					case MotorAction::MoveAbsolute:
-						right_drive_group.move_absolute(
-							step.right_drive_target,
-							step.right_drive_speed);
-
-						if (double_abs(
-							    right_drive_group
-								    .get_positions()
-									    [0] -
-							    step.right_drive_target) <=
-						    1.0)
-							num_ready_to_procede +=
-								1;
-						break;
-					case MotorAction::Brake:
-						right_drive_group.brake();
-						break;
-					}
-					break;
-				case AutoActionType::IntakeSetExtend:
-					if (step.intake_extend) {
-						intake_extension_group.move_absolute(
-							INTAKE_EXTENDED_POSITION,
-							step.intake_extend_speed);
-					} else {
-						intake_extension_group.move_absolute(
-							INTAKE_RETRACTED_POSITION,
-							step.intake_extend_speed);
-					}
-					break;
-				case AutoActionType::IntakeSpin:
-					intake_spin_group.move(
-						step.intake_spin_speed);
-					break;
-				case AutoActionType::DeployCatapult:
-					catapult_deployed_in_auto = true;
-					set_deploy_catapult();
-					break;
-				case AutoActionType::WaitForCatapultDeploy:
-					if (catapult_deploy_status ==
-					    CatapultDeployStatus::NotDeploying) {
-						num_ready_to_procede += 1;
-					}
-					break;
-				case AutoActionType::FireCatapultTime: {
-					catapult_group.move(
-						step.catapult_fire_speed);
-					Timer jam_timer = Timer();
-					if (catapult_group
-						    .get_current_draws()[0] >
-					    1750) {
-						bool do_unjam = true;
-						while (jam_timer
-							       .GetElapsedTime()
-							       .AsMilliseconds() <
-						       500) {
-							if (catapult_group
-								    .get_current_draws()
-									    [0] <
-							    1750) {
-								do_unjam =
-									false;
-								break;
-							}
-						}
-						if (do_unjam) {
-							catapult_group.move(
-								-MAX_VOLTAGE);
-							pros::delay(650);
-							catapult_group.move(0);
-							pros::delay(1000);
-						}
-					}
-				} break;
-				case AutoActionType::WaitForCatapultEngage:
-					catapult_group.move(MAX_VOLTAGE);
-					catapult_block.brake();
-					if (catapult_group
-						    .get_current_draws()[0] >
-					    500) {
-						num_ready_to_procede += 1;
-					}
-					break;
-				case AutoActionType::WaitForCatapultSlip:
-					catapult_group.move(MAX_VOLTAGE);
-					catapult_block.brake();
-					if (catapult_group
-						    .get_current_draws()[0] <
-					    300) {
-						num_ready_to_procede += 1;
-					}
-					break;
-				case AutoActionType::RunBlockingLambda:
-					step.lambda(auto_timer);
-					num_ready_to_procede += 1;
-					break;
-				}
-				pros::delay(5);
-				if (num_ready_to_procede >=
-					    step.required_num_to_procede ||
-				    auto_change_timer.GetElapsedTime()
-						    .AsMilliseconds() >
-					    step.timeout_ms) {
-					switch (step.action_type) {
-					case AutoActionType::TurnIMUFromStart: {
-						left_drive_group.set_brake_modes(
-							pros::E_MOTOR_BRAKE_HOLD);
-						right_drive_group.set_brake_modes(
-							pros::E_MOTOR_BRAKE_HOLD);
-						left_drive_group.brake();
-						right_drive_group.brake();
-					}
-					case AutoActionType::WaitForCatapultSlip:
-						catapult_group.brake();
-						break;
-					case AutoActionType::FireCatapultTime:
-						catapult_group.brake();
-					default:
-						break;
-					}
-					if (step.delay_ms_after_done != 0)
-						pros::delay(
-							step.delay_ms_after_done);
-					break;
-				}
-			}
-		}
+	void drive_power(double drive_voltage_left, double drive_voltage_right,
+			 double timeout_ms)
+	{
+		autonomous_steps.push_back(AutoStep::drive_power(
+			drive_voltage_left, drive_voltage_right, timeout_ms));
 	}
-};
 
-/**
- * Runs the user autonomous code. This function will be started in its own task
- * with the default priority and stack size whenever the robot is enabled via
- * the Field Management System or the VEX Competition Switch in the autonomous
- * mode. Alternatively, this function may be called in initialize or opcontrol
- * for non-competition testing purposes.
- *
- * If the robot is disabled or communications is lost, the autonomous task
- * will be stopped. Re-enabling the robot will restart the task, not re-start
- * it from where it left off.
- */
-void autonomous()
-{
-	// #define SKILLS
+	void set_intake_extension(bool intake_extend, double rpm,
+				  double timeout_ms)
+	{
+		autonomous_steps.push_back(AutoStep::set_intake_extension(
+			intake_extend, rpm, timeout_ms));
+	}
 
-	AutonomousSequence auto_sequence;
-	auto_sequence.start_timer();
-	has_imu_been_set = false;
-	has_intake_homed = false;
-#ifdef SKILLS
-	initCommon(false);
-#else
-	initCommon(true);
-#endif
+	void set_intake_spin(double intake_spin_voltage, double timeout_ms)
+	{
+		autonomous_steps.push_back(AutoStep::set_intake_spin(
+			intake_spin_voltage, timeout_ms));
+	}
 
-	left_drive_group.tare_position();
-	right_drive_group.tare_position();
-	left_drive_group.set_brake_modes(pros::E_MOTOR_BRAKE_HOLD);
-	right_drive_group.set_brake_modes(pros::E_MOTOR_BRAKE_HOLD);
+	void deploy_catapult()
+	{
+		autonomous_steps.push_back(AutoStep::deploy_catapult());
+	}
 
-#ifdef SKILLS
-	auto_sequence.deploy_catapult();
-	auto_sequence.drive_power(MAX_VOLTAGE, 500);
-	auto_sequence.drive_power(0, 250);
-	auto_sequence.move_position(DRIVE_UNITS_PER_INCH * -14,
-				    DRIVE_UNITS_PER_INCH * -9.5, MAX_RPM,
-				    MAX_RPM / 2.5, 750);
-	auto_sequence.move_position(DRIVE_UNITS_PER_INCH * -10, MAX_RPM, 500);
-	auto_sequence.move_position(DRIVE_UNITS_PER_INCH * -1,
-				    DRIVE_UNITS_PER_INCH * -18, MAX_RPM / 6.0,
-				    MAX_RPM, 1000);
-
-	auto_sequence.move_position(DRIVE_UNITS_PER_DEGREE * 35, -20,
-				    MAX_RPM / 4.0, MAX_RPM / 4.0, 500);
-	auto_sequence.wait_for_catapult_deploy();
-	// Fire catapult
-	auto_sequence.run_blocking_lambda([](Timer &auto_timer) {
-		catapult_block.brake();
+	void wait_for_catapult_deploy(double timeout_ms = 10000)
+	{
+		autonomous_steps.push_back(
+			AutoStep::wait_for_catapult_deploy(timeout_ms));
+	}
 
-		int step = 1;
-		Timer delay_timer;
-		while (true) {
-			// ctrl.print(0, 0, "%i", step);
-			uint32_t slip_angle =
-				std::max(
-					(uint32_t)0,
-					(uint32_t)(catapult_group
-							   .get_positions()[0] -
-						   1500.0)) %
-				1259;
-			// ctrl.print(0, 1, "%i", catapult_group.get_current_draws()[0]);
-			if (step == 1) {
-				catapult_group.move(MAX_VOLTAGE);
-				if (slip_angle >= 1100) {
-					delay_timer.Restart();
-					step += 1;
-					continue;
-				}
-			} else if (step == 2) {
-				catapult_group.brake();
-				if (delay_timer.GetElapsedTime()
-					    .AsMilliseconds() > 150) {
-					step += 1;
-					continue;
-				}
-			} else if (step == 3) {
-				catapult_group.move(MAX_VOLTAGE);
-				if (slip_angle < 100) {
-					step = 1;
-					continue;
-				}
-			}
+	void fire_catapult_time(double timeout_ms, double voltage = MAX_VOLTAGE)
+	{
+		autonomous_steps.push_back(
+			AutoStep::fire_catapult_time(timeout_ms, voltage));
+	}
 
-			// Timer starts when auto starts
-			if (auto_timer.GetElapsedTime().AsMilliseconds() >=
-			    49000)
-				break;
+	void wait_for_catapult_engage()
+	{
+		autonomous_steps.push_back(
+			AutoStep::wait_for_catapult_engage());
+	}
 
-			Timer jam_timer = Timer();
-			if (catapult_group.get_current_draws()[0] > 1750) {
-				bool do_unjam = true;
-				while (jam_timer.GetElapsedTime()
-					       .AsMilliseconds() < 500) {
-					if (catapult_group
-						    .get_current_draws()[0] <
-					    1750) {
-						do_unjam = false;
-						break;
-					}
-				}
-				if (do_unjam) {
-					catapult_group.move(-MAX_VOLTAGE);
-					pros::delay(650);
-					catapult_group.move(0);
-					pros::delay(500);
+	void wait_for_catapult_slip()
+	{
+		autonomous_steps.push_back(AutoStep::wait_for_catapult_slip());
+	}
+
+	void run_blocking_lambda(void (*func)(Timer &auto_timer))
+	{
+		autonomous_steps.push_back(AutoStep::run_blocking_lambda(func));
+	}
+
+	void run_auto()
+	{
+		run_auto(autonomous_steps.data(), autonomous_steps.size());
+	}
+
+	template <size_t N> void run_auto(const AutoStep (&steps)[N])
+	{
+		run_auto(steps, N);
+	}
+
+	// Timing and exit reason of the steps run by the last run_auto()
+	const StepLog &get_step_log() const
+	{
+		return step_log;
+	}
+
+	void run_auto(const AutoStep *steps, size_t num_steps)
+	{
+		drive_chain_pending = false;
+		step_log.clear();
+		for (size_t t = 0; t < NUM_AUTO_TRACKS; t++) {
+			tracks[t].cursor =
+				next_step_on_track(steps, num_steps, 0, t);
+			tracks[t].phase = StepPhase::NotStarted;
+		}
+
+		auto_sequence_task = pros::c::task_get_current();
+		while (true) {
+			sensors.sample(odometry);
+			handle_catapult_deploy();
+
+			// Steps that start because another one finished run in
+			// the same pass, so a transition costs no extra tick
+			size_t ticked[NUM_AUTO_TRACKS];
+			std::fill(ticked, ticked + NUM_AUTO_TRACKS, num_steps);
+			bool all_tracks_done;
+			bool advanced = true;
+			while (advanced) {
+				advanced = false;
+				all_tracks_done = true;
+				for (size_t t = 0; t < NUM_AUTO_TRACKS; t++) {
+					size_t i = tracks[t].cursor;
+					if (i >= num_steps)
+						continue;
+					all_tracks_done = false;
+					// Multi-track steps are run by their
+					// lowest track once all tracks arrive
+					if (i == ticked[t] ||
+					    owner_track(steps[i].tracks) != t ||
+					    !is_step_joined(steps[i], i))
+						continue;
+					ticked[t] = i;
+					if (tick_step(steps, num_steps, i))
+						advanced = true;
 				}
 			}
+			if (all_tracks_done)
+				break;
 
-			pros::delay(5);
+			// Sleep until the next deadline or poll, or until
+			// notify_auto_sequence() wakes us
+			uint32_t sleep_ms = next_wake_ms(steps, num_steps);
+			pros::c::task_notify_take(true, sleep_ms);
 		}
-		catapult_group.move(-MAX_VOLTAGE);
-		pros::delay(500);
-		catapult_group.move(0);
-	});
-	auto_sequence.drive_power(-MAX_VOLTAGE * 0.35, -MAX_VOLTAGE * 0.25,
-				  1200);
+		auto_sequence_task = nullptr;
+
+		// Print to the terminal for tuning timeouts
+		step_log.dump(stdout);
+	}
+};
+
+void wings_out(Timer &auto_timer)
+{
+	right_wing.set_value(true);
+	left_wing.set_value(true);
+}
+
+void wings_in(Timer &auto_timer)
+{
+	right_wing.set_value(false);
+	left_wing.set_value(false);
+}
+
+// Actions a routine from the SD card can run, indexed by RoutineNamedAction
+const AutoAction routine_named_actions[] = {
+	RunTask{ fire_catapult_match },
+	RunTask{ fire_catapult_skills },
+	RunBlockingLambda{ wings_out },
+	RunBlockingLambda{ wings_in },
+};
+static_assert(sizeof(routine_named_actions) /
+		      sizeof(routine_named_actions[0]) ==
+	      (size_t)RoutineNamedAction::Count);
+
+constexpr AutoStep skills_routine[] = {
+	AutoStep::deploy_catapult(),
+	AutoStep::drive_power(MAX_VOLTAGE, 500),
+	AutoStep::drive_power(0, 250),
+	AutoStep::move_position(DRIVE_UNITS_PER_INCH * -14,
+				DRIVE_UNITS_PER_INCH * -9.5, MAX_RPM,
+				MAX_RPM / 2.5, 750),
+	AutoStep::move_position(DRIVE_UNITS_PER_INCH * -10, MAX_RPM, 500),
+	AutoStep::move_position(DRIVE_UNITS_PER_INCH * -1,
+				DRIVE_UNITS_PER_INCH * -18, MAX_RPM / 6.0,
+				MAX_RPM, 1000),
+
+	AutoStep::move_position(DRIVE_UNITS_PER_DEGREE * 35, -20, MAX_RPM / 4.0,
+				MAX_RPM / 4.0, 500),
+	AutoStep::wait_for_catapult_deploy(),
+	// Fire catapult
+	AutoStep::run_task(fire_catapult_skills),
+	AutoStep::drive_power(-MAX_VOLTAGE * 0.35, -MAX_VOLTAGE * 0.25, 1200),
 	// Go to center
-	auto_sequence.move_position(0, DRIVE_UNITS_PER_DEGREE * 30, 0,
-				    MAX_RPM / 2.0, 2500);
-	auto_sequence.set_intake_spin(MAX_VOLTAGE, 0);
-	auto_sequence.move_position(DRIVE_UNITS_PER_INCH * 60, MAX_RPM, 1500);
+	AutoStep::move_position(0, DRIVE_UNITS_PER_DEGREE * 30, 0,
+				MAX_RPM / 2.0, 2500),
+	AutoStep::set_intake_spin(MAX_VOLTAGE, 0),
+	AutoStep::move_position(DRIVE_UNITS_PER_INCH * 60, MAX_RPM, 1500),
 	// Turn towards other side of field
-	auto_sequence.move_position(DRIVE_UNITS_PER_DEGREE * 75,
-				    DRIVE_UNITS_PER_DEGREE * -75, MAX_RPM / 2.0,
-				    MAX_RPM / 2.0, 750);
+	AutoStep::move_position(DRIVE_UNITS_PER_DEGREE * 75,
+				DRIVE_UNITS_PER_DEGREE * -75, MAX_RPM / 2.0,
+				MAX_RPM / 2.0, 750),
 	// Go across
-	auto_sequence.move_position(DRIVE_UNITS_PER_INCH * 90, MAX_RPM, 750);
-	auto_sequence.run_blocking_lambda([](Timer &auto_timer) {
-		right_wing.set_value(true);
-		left_wing.set_value(true);
-	});
-	auto_sequence.move_position(DRIVE_UNITS_PER_INCH * 90, MAX_RPM, 3500);
-	auto_sequence.run_blocking_lambda([](Timer &auto_timer) {
-		right_wing.set_value(false);
-		left_wing.set_value(false);
-	});
-	auto_sequence.drive_power(-MAX_VOLTAGE, 400);
-	auto_sequence.set_intake_spin(0, 0);
-#else
-	auto_sequence.deploy_catapult();
+	AutoStep::move_position(DRIVE_UNITS_PER_INCH * 90, MAX_RPM, 750),
+	AutoStep::run_blocking_lambda(wings_out),
+	AutoStep::move_position(DRIVE_UNITS_PER_INCH * 90, MAX_RPM, 3500),
+	AutoStep::run_blocking_lambda(wings_in),
+	AutoStep::drive_power(-MAX_VOLTAGE, 400),
+	AutoStep::set_intake_spin(0, 0),
+};
+
+constexpr AutoStep match_routine[] = {
+	AutoStep::deploy_catapult().on(CatapultTrack),
 	// Grab starting triball
-	auto_sequence.set_intake_spin(-MAX_VOLTAGE, 0);
-	auto_sequence.set_intake_extension(true, MAX_RPM / 2.0, 0);
-	auto_sequence.move_position(-DRIVE_UNITS_PER_INCH * 1.5, MAX_RPM / 4.0,
-				    1500);
-	auto_sequence.drive_power(0, 750);
-	auto_sequence.move_position(DRIVE_UNITS_PER_INCH * -6, MAX_RPM / 4.0,
-				    1000);
-	auto_sequence.set_intake_extension(false, MAX_RPM / 1.4, 500);
-	auto_sequence.set_intake_spin(0, 0);
+	AutoStep::set_intake_spin(-MAX_VOLTAGE, 0),
+	AutoStep::set_intake_extension(true, MAX_RPM / 2.0, 0),
+	AutoStep::move_position(-DRIVE_UNITS_PER_INCH * 1.5, MAX_RPM / 4.0,
+				1500),
+	AutoStep::drive_power(0, 750),
+	AutoStep::move_position(DRIVE_UNITS_PER_INCH * -6, MAX_RPM / 4.0, 1000),
+	// Pull the triball in while the drive turns towards the goal
+	AutoStep::join(DriveTrack | IntakeTrack),
+	AutoStep::set_intake_extension(false, MAX_RPM / 1.4, 500)
+		.on(IntakeTrack),
+	AutoStep::set_intake_spin(0, 0).on(IntakeTrack),
 	// Move towards goal
-	auto_sequence.turn_imu(Direction::Clockwise, 79, MAX_VOLTAGE, 1500);
-	auto_sequence.set_intake_spin(0, 0);
-	auto_sequence.move_position(DRIVE_UNITS_PER_INCH * 7, MAX_RPM / 4.0,
-				    2500);
-	// Deploy catapult
+	AutoStep::wait_for_imu().on(DriveTrack),
+	AutoStep::turn_imu(Direction::Clockwise, 79, MAX_VOLTAGE, 1500)
+		.on(DriveTrack),
+	AutoStep::move_position(DRIVE_UNITS_PER_INCH * 7, MAX_RPM / 4.0, 2500),
 	// Outake
-	auto_sequence.set_intake_extension(false, MAX_RPM, 100);
-	auto_sequence.set_intake_spin(MAX_VOLTAGE / 2.5, 0);
-	auto_sequence.move_position(DRIVE_UNITS_PER_INCH * -6, MAX_RPM / 3.0,
-				    2500);
-	auto_sequence.set_intake_spin(0, 0);
+	AutoStep::set_intake_extension(false, MAX_RPM, 100),
+	AutoStep::set_intake_spin(MAX_VOLTAGE / 2.5, 0),
+	AutoStep::move_position(DRIVE_UNITS_PER_INCH * -6, MAX_RPM / 3.0, 2500)
+		.chained(),
+	AutoStep::set_intake_spin(0, 0),
 	// Go back to matchload zone
-	auto_sequence.move_position(DRIVE_UNITS_PER_INCH * -4, MAX_RPM, 2500);
-	auto_sequence.turn_imu(Direction::Clockwise, 160, MAX_VOLTAGE, 1500);
-	auto_sequence.drive_power(-MAX_VOLTAGE, 300);
-	auto_sequence.drive_power(-MAX_VOLTAGE * 0.35, 750);
-	auto_sequence.move_position(DRIVE_UNITS_PER_DEGREE * 40, 0,
-				    MAX_RPM / 4.0, MAX_RPM / 4.0, 500);
+	AutoStep::move_position(DRIVE_UNITS_PER_INCH * -4, MAX_RPM, 2500),
+	AutoStep::turn_imu(Direction::Clockwise, 160, MAX_VOLTAGE, 1500),
+	AutoStep::drive_power(-MAX_VOLTAGE, 300).chained(),
+	AutoStep::drive_power(-MAX_VOLTAGE * 0.35, 750),
+	AutoStep::move_position(DRIVE_UNITS_PER_DEGREE * 40, 0, MAX_RPM / 4.0,
+				MAX_RPM / 4.0, 500),
 	// Fire catapult
-	auto_sequence.run_blocking_lambda([](Timer &auto_timer) {
-		Timer lambda_timer;
-		catapult_block.brake();
-
-		int step = 1;
-		Timer delay_timer;
-		while (true) {
-			// ctrl.print(0, 0, "%i", step);
-			uint32_t slip_angle =
-				std::max(
-					(uint32_t)0,
-					(uint32_t)(catapult_group
-							   .get_positions()[0] -
-						   1500.0)) %
-				1259;
-			// ctrl.print(0, 1, "%i", catapult_group.get_current_draws()[0]);
-			if (step == 1) {
-				catapult_group.move(MAX_VOLTAGE);
-				if (slip_angle >= 1100) {
-					delay_timer.Restart();
-					step += 1;
-					continue;
-				}
-			} else if (step == 2) {
-				catapult_group.brake();
-				if (delay_timer.GetElapsedTime()
-					    .AsMilliseconds() > 150) {
-					step += 1;
-					continue;
-				}
-			} else if (step == 3) {
-				catapult_group.move(MAX_VOLTAGE);
-				if (slip_angle < 100) {
-					step = 1;
-					continue;
-				}
-			}
-
-			// Timer starts when auto starts
-			if (auto_timer.GetElapsedTime().AsMilliseconds() >=
-			    28000)
-				break;
-
-			Timer jam_timer = Timer();
-			if (catapult_group.get_current_draws()[0] > 1750) {
-				bool do_unjam = true;
-				while (jam_timer.GetElapsedTime()
-					       .AsMilliseconds() < 500) {
-					if (catapult_group
-						    .get_current_draws()[0] <
-					    1750) {
-						do_unjam = false;
-						break;
-					}
-				}
-				if (do_unjam) {
-					catapult_group.move(-MAX_VOLTAGE);
-					pros::delay(650);
-					catapult_group.move(0);
-					pros::delay(500);
-				}
-			}
-
-			pros::delay(5);
-		}
-		catapult_group.move(-MAX_VOLTAGE);
-		pros::delay(500);
-		catapult_group.move(0);
-	});
+	AutoStep::run_task(fire_catapult_match),
 	// Home after firing
-	auto_sequence.drive_power(-MAX_VOLTAGE * 0.35, -MAX_VOLTAGE * 0.1,
-				  1000);
+	AutoStep::drive_power(-MAX_VOLTAGE * 0.35, -MAX_VOLTAGE * 0.1, 1000),
 	// Move and push triball under goal
-	auto_sequence.move_position(DRIVE_UNITS_PER_INCH * 7, MAX_RPM, 1000);
-	auto_sequence.turn_imu(Direction::Clockwise, 267, MAX_VOLTAGE, 1500);
-	auto_sequence.move_position(DRIVE_UNITS_PER_INCH * -18, MAX_RPM / 2.0,
-				    1000);
-	auto_sequence.turn_imu(Direction::Clockwise, 303, MAX_VOLTAGE, 1500);
-	auto_sequence.move_position(DRIVE_UNITS_PER_INCH * -19, MAX_RPM / 3.0,
-				    2500);
+	AutoStep::move_position(DRIVE_UNITS_PER_INCH * 7, MAX_RPM, 1000),
+	AutoStep::turn_imu(Direction::Clockwise, 267, MAX_VOLTAGE, 1500),
+	AutoStep::move_position(DRIVE_UNITS_PER_INCH * -18, MAX_RPM / 2.0,
+				1000),
+	AutoStep::turn_imu(Direction::Clockwise, 303, MAX_VOLTAGE, 1500),
+	AutoStep::move_position(DRIVE_UNITS_PER_INCH * -19, MAX_RPM / 3.0,
+				2500),
 	// Move to post
-	auto_sequence.turn_imu_separate(Direction::CounterClockwise, 210, 0,
-					MAX_VOLTAGE, 3000);
-	auto_sequence.move_position(DRIVE_UNITS_PER_INCH * 30, MAX_RPM, 2500);
-	auto_sequence.turn_imu(Direction::Clockwise, 223, MAX_VOLTAGE, 1500);
-	auto_sequence.wait_until_match_time(41.0);
-	auto_sequence.move_position(DRIVE_UNITS_PER_INCH * 13, MAX_RPM / 4.0,
-				    2500);
-#endif
+	AutoStep::turn_imu_separate(Direction::CounterClockwise, 210, 0,
+				    MAX_VOLTAGE, 3000),
+	AutoStep::move_position(DRIVE_UNITS_PER_INCH * 30, MAX_RPM, 2500),
+	AutoStep::turn_imu(Direction::Clockwise, 223, MAX_VOLTAGE, 1500),
+	AutoStep::wait_until_match_time(41.0),
+	AutoStep::move_position(DRIVE_UNITS_PER_INCH * 13, MAX_RPM / 4.0, 2500),
+};
 
-	auto_sequence.run_auto();
+#define SD_ROUTINE_PATH "/usd/routine.bin"
 
-	left_drive_group.set_brake_modes(pros::E_MOTOR_BRAKE_COAST);
-	right_drive_group.set_brake_modes(pros::E_MOTOR_BRAKE_COAST);
+// Routine compiled by tools/routinec and loaded from the SD card. When this is
+// empty autonomous() falls back to the built in routines above.
+std::vector<AutoStep> sd_routine;
+bool sd_routine_checked = false;
+
+void load_sd_routine()
+{
+	sd_routine_checked = true;
+	if (pros::usd::is_installed())
+		load_routine(SD_ROUTINE_PATH, sd_routine,
+			     routine_named_actions);
 }
 
+/**
+ * Runs after initialize(), and before autonomous when connected to the Field
+ * Management System or the VEX Competition Switch. This is intended for
+ * competition-specific initialization routines, such as an autonomous selector
+ * on the LCD.
+ *
+ * This task will exit when the robot is enabled and autonomous or opcontrol
+ * starts.
+ */
+void competition_initialize()
+{
+	// Parse the SD card routine now so it costs nothing once the match
+	// starts
+	load_sd_routine();
+}
+
+#define DRIVER_TICK_MS 5
+#define INPUT_RECORDING_PATH "/usd/inputs.bin"
+// Curve the drive sticks are shaped by, see joystick.h
+#define DRIVER_JOYSTICK_CURVE JoystickCurve::Linear
+
+SlewLimiter left_drive_slew;
+SlewLimiter right_drive_slew;
+
 std::unique_ptr<Timer> intake_extension_toggle_timer =
 	std::make_unique<Timer>();
 bool is_intake_extended = false;
@@ -1008,6 +1365,279 @@ bool climb_arm_deployed = false;
 bool climb_trigger_timer_running = false;
 std::unique_ptr<Timer> climb_trigger_timer = std::make_unique<Timer>();
 
+InputRecorder input_recorder;
+
+DriverInput read_driver_input()
+{
+	static const struct {
+		pros::controller_digital_e_t digital;
+		DriverButton button;
+	} buttons[] = {
+		{ DIGITAL_R1, ButtonR1 },     { DIGITAL_R2, ButtonR2 },
+		{ DIGITAL_L1, ButtonL1 },     { DIGITAL_L2, ButtonL2 },
+		{ DIGITAL_UP, ButtonUp },     { DIGITAL_DOWN, ButtonDown },
+		{ DIGITAL_LEFT, ButtonLeft }, { DIGITAL_RIGHT, ButtonRight },
+		{ DIGITAL_X, ButtonX },	      { DIGITAL_B, ButtonB },
+	};
+
+	DriverInput input = { (int8_t)ctrl.get_analog(ANALOG_LEFT_Y),
+			      (int8_t)ctrl.get_analog(ANALOG_RIGHT_Y), 0 };
+	for (const auto &entry : buttons) {
+		if (ctrl.get_digital(entry.digital))
+			input.buttons |= entry.button;
+	}
+	return input;
+}
+
+// One tick of driver control, from the controller or from a recording
+void handle_driver_input(const DriverInput &input)
+{
+	// ctrl.print(0, 0, "%i", catapult_group.get_current_draws()[0]);
+	// ctrl.set_text(0, 0, std::to_string(imu.get_rotation()));
+
+	left_drive_group = left_drive_slew.step(
+		shape_joystick(DRIVER_JOYSTICK_CURVE, input.left_y));
+	right_drive_group = right_drive_slew.step(
+		shape_joystick(DRIVER_JOYSTICK_CURVE, input.right_y));
+
+	bool right_trigger_upper = input.pressed(ButtonR1);
+	if (right_trigger_upper &&
+	    intake_extension_toggle_timer->GetElapsedTime().AsMilliseconds() >
+		    200) {
+		is_intake_extended = !is_intake_extended;
+		intake_extension_toggle_timer->Restart();
+	}
+
+	if (is_intake_extended) {
+		intake_extension_group.move_absolute(INTAKE_EXTENDED_POSITION,
+						     MAX_RPM);
+	} else {
+		intake_extension_group.move_absolute(INTAKE_RETRACTED_POSITION,
+						     MAX_RPM);
+	}
+
+	// Left wing control code
+	if (input.pressed(ButtonDown) &&
+	    left_wing_toggle_timer->GetElapsedTime().AsMilliseconds() > 200) {
+		left_wing_deployed = !left_wing_deployed;
+		left_wing.set_value(left_wing_deployed);
+		left_wing_toggle_timer->Restart();
+	}
+
+	// Right wing control code
+	if (input.pressed(ButtonB) &&
+	    right_wing_toggle_timer->GetElapsedTime().AsMilliseconds() > 200) {
+		right_wing_deployed = !right_wing_deployed;
+		right_wing.set_value(right_wing_deployed);
+		right_wing_toggle_timer->Restart();
+	}
+
+	// bool right_trigger_upper = ctrl.get_digital(DIGITAL_R1);
+	bool do_intake = input.pressed(ButtonL2);
+	bool do_outtake = input.pressed(ButtonL1);
+	if (do_intake) {
+		intake_spin_group.move(MAX_VOLTAGE);
+	} else if (do_outtake) {
+		intake_spin_group.move(-MAX_VOLTAGE);
+	} else {
+		intake_spin_group = 0;
+	}
+
+	// Catapult controls:
+	if (catapult_deploy_status == CatapultDeployStatus::NotDeploying) {
+		bool do_fire_catapult = input.pressed(ButtonR2);
+		bool do_reverse_catapult = input.pressed(ButtonUp);
+		if (do_reverse_catapult) {
+			catapult_group.move(-MAX_VOLTAGE);
+		} else if (do_fire_catapult) {
+			catapult_group.move(MAX_VOLTAGE);
+			catapult_block.brake();
+			// pros::lcd::set_text(1, std::to_string(catapult_group.get_current_draws()[0]));
+		} else {
+			catapult_group.brake();
+			catapult_block.brake();
+		}
+
+		bool do_place_block = input.pressed(ButtonLeft);
+		bool do_remove_block = input.pressed(ButtonRight);
+		if (do_place_block) {
+			catapult_block.move(-MAX_VOLTAGE);
+		} else if (do_remove_block) {
+			catapult_block.move(MAX_VOLTAGE);
+		}
+
+		bool do_deploy_catapult = input.pressed(ButtonX);
+		if (do_deploy_catapult) {
+			if (catapult_button_timer_running == false) {
+				catapult_button_timer->Restart();
+				catapult_button_timer_running = true;
+			} else if (catapult_button_timer->GetElapsedTime()
+					   .AsMilliseconds() > 250.0) {
+				set_deploy_catapult();
+			}
+		} else {
+			catapult_button_timer_running = false;
+		}
+	}
+}
+
+/*
+ * Drives the robot from a recording of driver control, ticking at the rate it
+ * was recorded at so it plays back with the same timing.
+ */
+void replay_driver_inputs(InputPlayer &player)
+{
+	// Start off the same way opcontrol() does
+	left_drive_group.set_brake_modes(pros::E_MOTOR_BRAKE_COAST);
+	right_drive_group.set_brake_modes(pros::E_MOTOR_BRAKE_COAST);
+	left_drive_slew.reset();
+	right_drive_slew.reset();
+	catapult_deployed_in_auto = true;
+	set_deploy_catapult();
+
+	DriverInput input;
+	uint32_t now = pros::millis();
+	while (player.next(input)) {
+		sensors.sample(odometry);
+		handle_catapult_deploy();
+		handle_driver_input(input);
+		pros::c::task_delay_until(&now, player.tick_ms());
+	}
+	left_drive_group.brake();
+	right_drive_group.brake();
+	intake_spin_group.brake();
+	catapult_group.brake();
+}
+
+#define CHARACTERIZATION_PATH "/usd/characterize_%s.csv"
+#define CHARACTERIZATION_REST_MS 1000
+
+// Fits and logs one mechanism's samples, printing its constants
+void report_characterization(const char *name,
+			     const Characterization &characterization)
+{
+	Feedforward feedforward;
+	if (characterization.fit(feedforward)) {
+		printf("%s: ks %.3f kv %.4f ka %.5f (%u samples)\n", name,
+		       feedforward.ks, feedforward.kv, feedforward.ka,
+		       (unsigned)characterization.num_samples());
+	} else {
+		printf("%s: not enough movement to fit\n", name);
+	}
+
+	if (!pros::usd::is_installed())
+		return;
+	char path[64];
+	snprintf(path, sizeof(path), CHARACTERIZATION_PATH, name);
+	FILE *file = fopen(path, "w");
+	if (file != nullptr) {
+		characterization.dump(file);
+		fclose(file);
+	}
+}
+
+/*
+ * Measures the feedforward constants of the drive and catapult. The drive
+ * runs each test forwards and then backwards so it ends up about where it
+ * started, so give it a couple of meters of clear field. The catapult only
+ * turns forwards, since its slip gear won't run backwards.
+ */
+void characterize_mechanisms()
+{
+	DriveMotorGroup *drive_groups[] = { &left_drive_group,
+					    &right_drive_group };
+	Characterization drive_results[2];
+	left_drive_group.set_brake_modes(pros::E_MOTOR_BRAKE_COAST);
+	right_drive_group.set_brake_modes(pros::E_MOTOR_BRAKE_COAST);
+	for (CharacterizationTest test : { CharacterizationTest::Quasistatic,
+					   CharacterizationTest::Step }) {
+		for (double direction : { 1.0, -1.0 }) {
+			run_characterization_test(test, direction,
+						  drive_groups, drive_results,
+						  2);
+			pros::delay(CHARACTERIZATION_REST_MS);
+		}
+	}
+	report_characterization("left_drive", drive_results[0]);
+	report_characterization("right_drive", drive_results[1]);
+
+	decltype(catapult_group) *catapult_groups[] = { &catapult_group };
+	Characterization catapult_result;
+	for (CharacterizationTest test : { CharacterizationTest::Quasistatic,
+					   CharacterizationTest::Step }) {
+		run_characterization_test(test, 1.0, catapult_groups,
+					  &catapult_result, 1);
+		pros::delay(CHARACTERIZATION_REST_MS);
+	}
+	report_characterization("catapult", catapult_result);
+}
+
+/**
+ * Runs the user autonomous code. This function will be started in its own task
+ * with the default priority and stack size whenever the robot is enabled via
+ * the Field Management System or the VEX Competition Switch in the autonomous
+ * mode. Alternatively, this function may be called in initialize or opcontrol
+ * for non-competition testing purposes.
+ *
+ * If the robot is disabled or communications is lost, the autonomous task
+ * will be stopped. Re-enabling the robot will restart the task, not re-start
+ * it from where it left off.
+ */
+void autonomous()
+{
+	// #define SKILLS
+
+	AutonomousSequence auto_sequence;
+	auto_sequence.start_timer();
+	// Without a competition switch competition_initialize() never ran
+	if (!sd_routine_checked)
+		load_sd_routine();
+	has_intake_homed = false;
+	initCommon();
+#ifdef SKILLS
+	auto_sequence.set_match_length_ms(SKILLS_AUTO_LENGTH_MS);
+#else
+	auto_sequence.set_match_length_ms(MATCH_AUTO_LENGTH_MS);
+#endif
+
+	// #define CHARACTERIZE
+#ifdef CHARACTERIZE
+	// Runs the feedforward tests instead of a routine
+	characterize_mechanisms();
+	return;
+#endif
+
+#ifdef SKILLS
+	// A recorded skills run from opcontrol() takes the place of the routine
+	InputPlayer input_player;
+	if (pros::usd::is_installed() &&
+	    input_player.load(INPUT_RECORDING_PATH)) {
+		replay_driver_inputs(input_player);
+		return;
+	}
+#endif
+
+	left_drive_group.tare_position();
+	right_drive_group.tare_position();
+	// The field is measured from where the robot starts autonomous
+	odometry.set_pose({ 0.0, 0.0, 0.0, 0 });
+	left_drive_group.set_brake_modes(pros::E_MOTOR_BRAKE_HOLD);
+	right_drive_group.set_brake_modes(pros::E_MOTOR_BRAKE_HOLD);
+
+	if (!sd_routine.empty()) {
+		auto_sequence.run_auto(sd_routine.data(), sd_routine.size());
+	} else {
+#ifdef SKILLS
+		auto_sequence.run_auto(skills_routine);
+#else
+		auto_sequence.run_auto(match_routine);
+#endif
+	}
+
+	left_drive_group.set_brake_modes(pros::E_MOTOR_BRAKE_COAST);
+	right_drive_group.set_brake_modes(pros::E_MOTOR_BRAKE_COAST);
+}
+
 /**
  * Runs the operator control code. This function will be started in its own
  * task with the default priority and stack size whenever the robot is enabled
@@ -1023,106 +1653,41 @@ std::unique_ptr<Timer> climb_trigger_timer = std::make_unique<Timer>();
  */
 void opcontrol()
 {
-	initCommon(false);
+	auto_sequence_task = nullptr;
+	initCommon();
+	left_drive_slew.reset();
+	right_drive_slew.reset();
 
 	if (!catapult_deployed_in_auto)
 		set_deploy_catapult();
 
+	// #define RECORD_INPUTS
+#ifdef RECORD_INPUTS
+	// Records the first 60 s of driving for replaying in skills
+	bool recording = true;
+	input_recorder.clear();
+#endif
+
+	uint32_t now = pros::millis();
 	while (true) {
+		sensors.sample(odometry);
 		handle_catapult_deploy();
 
-		// ctrl.print(0, 0, "%i", catapult_group.get_current_draws()[0]);
-		// ctrl.set_text(0, 0, std::to_string(imu.get_rotation()));
-
-		int l_stick_y = ctrl.get_analog(ANALOG_LEFT_Y);
-		int r_stick_y = ctrl.get_analog(ANALOG_RIGHT_Y);
-		left_drive_group = l_stick_y;
-		right_drive_group = r_stick_y;
-
-		int right_trigger_upper = ctrl.get_digital(DIGITAL_R1);
-		if (right_trigger_upper &&
-		    intake_extension_toggle_timer->GetElapsedTime()
-				    .AsMilliseconds() > 200) {
-			is_intake_extended = !is_intake_extended;
-			intake_extension_toggle_timer->Restart();
-		}
-
-		if (is_intake_extended) {
-			intake_extension_group.move_absolute(
-				INTAKE_EXTENDED_POSITION, MAX_RPM);
-		} else {
-			intake_extension_group.move_absolute(
-				INTAKE_RETRACTED_POSITION, MAX_RPM);
-		}
-
-		// Left wing control code
-		if (ctrl.get_digital(DIGITAL_DOWN) &&
-		    left_wing_toggle_timer->GetElapsedTime().AsMilliseconds() >
-			    200) {
-			left_wing_deployed = !left_wing_deployed;
-			left_wing.set_value(left_wing_deployed);
-			left_wing_toggle_timer->Restart();
-		}
-
-		// Right wing control code
-		if (ctrl.get_digital(DIGITAL_B) &&
-		    right_wing_toggle_timer->GetElapsedTime().AsMilliseconds() >
-			    200) {
-			right_wing_deployed = !right_wing_deployed;
-			right_wing.set_value(right_wing_deployed);
-			right_wing_toggle_timer->Restart();
-		}
-
-		// bool right_trigger_upper = ctrl.get_digital(DIGITAL_R1);
-		bool do_intake = ctrl.get_digital(DIGITAL_L2);
-		bool do_outtake = ctrl.get_digital(DIGITAL_L1);
-		if (do_intake) {
-			intake_spin_group.move(MAX_VOLTAGE);
-		} else if (do_outtake) {
-			intake_spin_group.move(-MAX_VOLTAGE);
-		} else {
-			intake_spin_group = 0;
-		}
-
-		// Catapult controls:
-		if (catapult_deploy_status ==
-		    CatapultDeployStatus::NotDeploying) {
-			bool do_fire_catapult = ctrl.get_digital(DIGITAL_R2);
-			bool do_reverse_catapult = ctrl.get_digital(DIGITAL_UP);
-			if (do_reverse_catapult) {
-				catapult_group.move(-MAX_VOLTAGE);
-			} else if (do_fire_catapult) {
-				catapult_group.move(MAX_VOLTAGE);
-				catapult_block.brake();
-				// pros::lcd::set_text(1, std::to_string(catapult_group.get_current_draws()[0]));
-			} else {
-				catapult_group.brake();
-				catapult_block.brake();
-			}
-
-			bool do_place_block = ctrl.get_digital(DIGITAL_LEFT);
-			bool do_remove_block = ctrl.get_digital(DIGITAL_RIGHT);
-			if (do_place_block) {
-				catapult_block.move(-MAX_VOLTAGE);
-			} else if (do_remove_block) {
-				catapult_block.move(MAX_VOLTAGE);
-			}
-
-			bool do_deploy_catapult = ctrl.get_digital(DIGITAL_X);
-			if (do_deploy_catapult) {
-				if (catapult_button_timer_running == false) {
-					catapult_button_timer->Restart();
-					catapult_button_timer_running = true;
-				} else if (catapult_button_timer
-						   ->GetElapsedTime()
-						   .AsMilliseconds() > 250.0) {
-					set_deploy_catapult();
-				}
-			} else {
-				catapult_button_timer_running = false;
+		DriverInput input = read_driver_input();
+#ifdef RECORD_INPUTS
+		if (recording) {
+			input_recorder.add(input);
+			if (input_recorder.num_ticks() * DRIVER_TICK_MS >=
+			    SKILLS_AUTO_LENGTH_MS) {
+				input_recorder.save(INPUT_RECORDING_PATH,
+						    DRIVER_TICK_MS);
+				ctrl.rumble("-");
+				recording = false;
 			}
 		}
+#endif
+		handle_driver_input(input);
 
-		pros::delay(5);
+		pros::c::task_delay_until(&now, DRIVER_TICK_MS);
 	}
 }
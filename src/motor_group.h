@@ -0,0 +1,144 @@
+#pragma once
+
+#include "pros/motors.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+/*
+ * Motors driven together, like pros::Motor_Group, but with the number of
+ * motors fixed at compile time. Getters return a std::array instead of a
+ * std::vector, so reading a group every tick never touches the heap.
+ *
+ * Construct it from a ports.h macro, with negative ports for reversed motors:
+ *
+ *	MotorGroup left_drive_group(LEFT_DRIVE_PORTS);
+ */
+template <size_t N> class MotorGroup {
+	public:
+	MotorGroup(const int8_t (&ports)[N])
+	{
+		for (size_t i = 0; i < N; i++) {
+			m_Ports[i] = (uint8_t)std::abs(ports[i]);
+			pros::c::motor_set_reversed(m_Ports[i], ports[i] < 0);
+		}
+	}
+
+	MotorGroup &operator=(int32_t voltage)
+	{
+		move(voltage);
+		return *this;
+	}
+
+	// Voltage out of 127
+	void move(int32_t voltage)
+	{
+		for (uint8_t port : m_Ports)
+			pros::c::motor_move(port, voltage);
+	}
+
+	void move_voltage(int32_t millivolts)
+	{
+		for (uint8_t port : m_Ports)
+			pros::c::motor_move_voltage(port, millivolts);
+	}
+
+	void move_velocity(int32_t rpm)
+	{
+		for (uint8_t port : m_Ports)
+			pros::c::motor_move_velocity(port, rpm);
+	}
+
+	void move_absolute(double position, int32_t rpm)
+	{
+		for (uint8_t port : m_Ports)
+			pros::c::motor_move_absolute(port, position, rpm);
+	}
+
+	void brake()
+	{
+		for (uint8_t port : m_Ports)
+			pros::c::motor_brake(port);
+	}
+
+	void tare_position()
+	{
+		for (uint8_t port : m_Ports)
+			pros::c::motor_tare_position(port);
+	}
+
+	void set_gearing(pros::motor_gearset_e_t gearset)
+	{
+		for (uint8_t port : m_Ports)
+			pros::c::motor_set_gearing(port, gearset);
+	}
+
+	void set_encoder_units(pros::motor_encoder_units_e_t units)
+	{
+		for (uint8_t port : m_Ports)
+			pros::c::motor_set_encoder_units(port, units);
+	}
+
+	void set_brake_modes(pros::motor_brake_mode_e_t mode)
+	{
+		for (uint8_t port : m_Ports)
+			pros::c::motor_set_brake_mode(port, mode);
+	}
+
+	std::array<double, N> get_positions() const
+	{
+		std::array<double, N> positions;
+		for (size_t i = 0; i < N; i++)
+			positions[i] = pros::c::motor_get_position(m_Ports[i]);
+		return positions;
+	}
+
+	// Encoder counts that tare_position() doesn't move, along with when
+	// each was read
+	std::array<int32_t, N>
+	get_raw_positions(std::array<uint32_t, N> &timestamps) const
+	{
+		std::array<int32_t, N> positions;
+		for (size_t i = 0; i < N; i++)
+			positions[i] = pros::c::motor_get_raw_position(
+				m_Ports[i], &timestamps[i]);
+		return positions;
+	}
+
+	std::array<double, N> get_actual_velocities() const
+	{
+		std::array<double, N> velocities;
+		for (size_t i = 0; i < N; i++)
+			velocities[i] =
+				pros::c::motor_get_actual_velocity(m_Ports[i]);
+		return velocities;
+	}
+
+	std::array<int32_t, N> get_current_draws() const
+	{
+		std::array<int32_t, N> currents;
+		for (size_t i = 0; i < N; i++)
+			currents[i] =
+				pros::c::motor_get_current_draw(m_Ports[i]);
+		return currents;
+	}
+
+	std::array<double, N> get_temperatures() const
+	{
+		std::array<double, N> temperatures;
+		for (size_t i = 0; i < N; i++)
+			temperatures[i] =
+				pros::c::motor_get_temperature(m_Ports[i]);
+		return temperatures;
+	}
+
+	static constexpr size_t size()
+	{
+		return N;
+	}
+
+	private:
+	std::array<uint8_t, N> m_Ports;
+};
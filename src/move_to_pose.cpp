@@ -0,0 +1,81 @@
+#include "move_to_pose.h"
+
+#include "constants.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define DEGREES_TO_RADIANS (M_PI / 180.0)
+// Drive voltage per inch of distance and per degree of heading error
+#define MOVE_TO_POSE_LINEAR_KP 8.0
+#define MOVE_TO_POSE_ANGULAR_KP 2.0
+// Distance the carrot is dropped in favour of the target heading within,
+// since the angle to a point that close swings wildly with any error
+#define MOVE_TO_POSE_CLOSE_DISTANCE 6.0
+
+// Wraps an angle in degrees into [-180, 180)
+static double wrap_degrees(double degrees)
+{
+	return degrees - 360.0 * floor((degrees + 180.0) / 360.0);
+}
+
+MoveToPoseCommand move_to_pose(const Pose &pose, const MoveToPose &target,
+			       bool &close)
+{
+	double dx = target.x - pose.x;
+	double dy = target.y - pose.y;
+	double distance = hypot(dx, dy);
+	if (distance < MOVE_TO_POSE_CLOSE_DISTANCE)
+		close = true;
+
+	// Driving backwards is driving forwards with the robot and target
+	// turned around
+	double flip = target.reversed ? 180.0 : 0.0;
+	double heading = pose.heading + flip;
+	double target_heading = target.heading + flip;
+
+	double linear;
+	double heading_error;
+	if (close) {
+		// Square up while covering what's left along the robot's
+		// heading, which backs up again after an overshoot
+		heading_error = wrap_degrees(target_heading - heading);
+		linear = MOVE_TO_POSE_LINEAR_KP *
+			 (dx * cos(heading * DEGREES_TO_RADIANS) +
+			  dy * sin(heading * DEGREES_TO_RADIANS));
+	} else {
+		double carrot_x =
+			target.x - distance * target.lead *
+					   cos(target_heading *
+					       DEGREES_TO_RADIANS);
+		double carrot_y =
+			target.y - distance * target.lead *
+					   sin(target_heading *
+					       DEGREES_TO_RADIANS);
+		double carrot_dx = carrot_x - pose.x;
+		double carrot_dy = carrot_y - pose.y;
+		heading_error = wrap_degrees(
+			atan2(carrot_dy, carrot_dx) / DEGREES_TO_RADIANS -
+			heading);
+		// Slow down while pointed away from the carrot so the robot
+		// turns towards it rather than driving off sideways
+		linear = MOVE_TO_POSE_LINEAR_KP * hypot(carrot_dx, carrot_dy) *
+			 std::max(cos(heading_error * DEGREES_TO_RADIANS), 0.0);
+	}
+
+	linear = std::clamp(linear, (double)-target.max_linear,
+			    (double)target.max_linear);
+	double angular = std::clamp(MOVE_TO_POSE_ANGULAR_KP * heading_error,
+				    (double)-target.max_angular,
+				    (double)target.max_angular);
+	// Turning keeps priority over driving when the two add up to more
+	// than the motors have
+	double linear_limit = MAX_VOLTAGE - std::abs(angular);
+	linear = std::clamp(linear, -linear_limit, linear_limit);
+
+	if (target.reversed)
+		linear = -linear;
+	return { (float)(linear + angular), (float)(linear - angular),
+		 (float)distance,
+		 (float)wrap_degrees(target.heading - pose.heading) };
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "auto_step.h"
+#include "odometry.h"
+
+// How close to the target pose counts as having reached it, in inches and
+// degrees
+#define MOVE_TO_POSE_END_RANGE 1.5
+#define MOVE_TO_POSE_HEADING_RANGE 3.0
+
+struct MoveToPoseCommand {
+	// Left and right drive voltage
+	float left;
+	float right;
+	float distance;
+	float heading_error;
+};
+
+/*
+ * One step of a boomerang controller towards target from pose. close latches
+ * once the robot is near enough that it should only square up to the target
+ * heading rather than chase the carrot; start it at false.
+ */
+MoveToPoseCommand move_to_pose(const Pose &pose, const MoveToPose &target,
+			       bool &close);
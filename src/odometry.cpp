@@ -0,0 +1,149 @@
+#include "odometry.h"
+
+#include "constants.h"
+#include "pros/error.h"
+#include "pros/rtos.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#define DEGREES_TO_RADIANS (M_PI / 180.0)
+
+/*
+ * Average encoder reading of a drive group in degrees. Raw counts aren't moved
+ * by tare_position(), which every drive step does. Unplugged motors are left
+ * out. time_ms is raised to the newest reading's timestamp.
+ */
+static double average_position(DriveMotorGroup &group, uint32_t &time_ms)
+{
+	std::array<uint32_t, DriveMotorGroup::size()> timestamps;
+	std::array<int32_t, DriveMotorGroup::size()> positions =
+		group.get_raw_positions(timestamps);
+	double sum = 0.0;
+	size_t count = 0;
+	for (size_t i = 0; i < DriveMotorGroup::size(); i++) {
+		if (positions[i] == PROS_ERR)
+			continue;
+		sum += positions[i];
+		time_ms = std::max(time_ms, timestamps[i]);
+		count++;
+	}
+	if (count == 0)
+		return 0.0;
+	return sum / count * DRIVE_DEGREES_PER_TICK;
+}
+
+Odometry::Odometry(DriveMotorGroup &left_drive, DriveMotorGroup &right_drive,
+		   ImuSampler &imu)
+	: m_LeftDrive(left_drive), m_RightDrive(right_drive), m_Imu(imu)
+{
+}
+
+void Odometry::start()
+{
+	uint32_t time_ms = 0;
+	m_LastLeft = average_position(m_LeftDrive, time_ms);
+	m_LastRight = average_position(m_RightDrive, time_ms);
+	pros::c::task_create(task_entry, this, TASK_PRIORITY_DEFAULT + 1,
+			     TASK_STACK_DEPTH_DEFAULT, "Odometry");
+}
+
+Pose Odometry::get_pose() const
+{
+	Pose pose;
+	uint32_t sequence;
+	do {
+		sequence = m_Sequence.load(std::memory_order_acquire);
+		pose.x = m_X.load(std::memory_order_relaxed);
+		pose.y = m_Y.load(std::memory_order_relaxed);
+		pose.heading = m_Heading.load(std::memory_order_relaxed);
+		pose.time_ms = m_TimeMs.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((sequence & 1) ||
+		 sequence != m_Sequence.load(std::memory_order_relaxed));
+	return pose;
+}
+
+void Odometry::set_pose(const Pose &pose)
+{
+	m_ResetPose = pose;
+	m_ResetPending.store(true, std::memory_order_release);
+}
+
+void Odometry::task_entry(void *odometry)
+{
+	uint32_t now = pros::millis();
+	while (true) {
+		((Odometry *)odometry)->update();
+		pros::c::task_delay_until(&now, ODOMETRY_PERIOD_MS);
+	}
+}
+
+void Odometry::update()
+{
+	uint32_t time_ms = 0;
+	double left = average_position(m_LeftDrive, time_ms);
+	double right = average_position(m_RightDrive, time_ms);
+	if (time_ms == 0)
+		time_ms = pros::millis();
+	double left_delta = left - m_LastLeft;
+	double right_delta = right - m_LastRight;
+	m_LastLeft = left;
+	m_LastRight = right;
+
+	// The IMU reading from when the encoders were read, so a turn doesn't
+	// skew the arc by however far the two drifted apart
+	ImuSample sample;
+	bool imu_ready = (m_Imu.sample_at(time_ms * 1000ull, sample) ||
+			  m_Imu.latest(sample)) &&
+			 !sample.calibrating && std::isfinite(sample.rotation);
+	double rotation = sample.rotation;
+
+	if (m_ResetPending.load(std::memory_order_acquire)) {
+		m_PoseX = m_ResetPose.x;
+		m_PoseY = m_ResetPose.y;
+		m_PoseHeading = m_ResetPose.heading;
+		m_ImuReady = false;
+		m_ResetPending.store(false, std::memory_order_relaxed);
+		left_delta = 0.0;
+		right_delta = 0.0;
+	}
+
+	double heading;
+	if (imu_ready) {
+		if (!m_ImuReady)
+			m_ImuOffset = m_PoseHeading - rotation;
+		heading = rotation + m_ImuOffset;
+	} else {
+		// A point turn moves each side DRIVE_UNITS_PER_DEGREE per
+		// degree, left forwards for clockwise
+		heading = m_PoseHeading + (left_delta - right_delta) / 2.0 /
+						  DRIVE_UNITS_PER_DEGREE;
+	}
+	m_ImuReady = imu_ready;
+
+	// Moving along the average of the old and new heading is close to the
+	// arc driven in one period
+	double distance =
+		(left_delta + right_delta) / 2.0 / DRIVE_UNITS_PER_INCH;
+	double mid_heading =
+		(m_PoseHeading + heading) / 2.0 * DEGREES_TO_RADIANS;
+	m_PoseX += distance * cos(mid_heading);
+	m_PoseY += distance * sin(mid_heading);
+	m_PoseHeading = heading;
+
+	publish(m_PoseX, m_PoseY, m_PoseHeading, time_ms);
+}
+
+void Odometry::publish(double x, double y, double heading, uint32_t time_ms)
+{
+	uint32_t sequence = m_Sequence.load(std::memory_order_relaxed);
+	m_Sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_X.store(x, std::memory_order_relaxed);
+	m_Y.store(y, std::memory_order_relaxed);
+	m_Heading.store(heading, std::memory_order_relaxed);
+	m_TimeMs.store(time_ms, std::memory_order_relaxed);
+	m_Sequence.store(sequence + 2, std::memory_order_release);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "motor_group.h"
+#include "ports.h"
+#include "imu_sampler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+
+#define ODOMETRY_PERIOD_MS 10
+
+typedef MotorGroup<std::size(LEFT_DRIVE_PORTS)> DriveMotorGroup;
+static_assert(std::size(RIGHT_DRIVE_PORTS) == DriveMotorGroup::size(),
+	      "both sides of the drive share DriveMotorGroup");
+
+/*
+ * Where the robot is on the field. x is forwards from where autonomous
+ * started and y is to its right, both in inches. heading is in degrees
+ * clockwise, the same way as imu.get_rotation().
+ */
+struct Pose {
+	float x;
+	float y;
+	float heading;
+	// When the encoders the pose came from were read
+	uint32_t time_ms;
+};
+
+/*
+ * Tracks the robot's pose from the drive encoders on a task of its own, using
+ * the IMU for heading whenever it is calibrated and the difference between
+ * the sides when it isn't. The task keeps running across autonomous and
+ * driver control once started.
+ */
+class Odometry {
+	public:
+	Odometry(DriveMotorGroup &left_drive, DriveMotorGroup &right_drive,
+		 ImuSampler &imu);
+
+	void start();
+
+	// Latest pose. Never blocks, so it is safe to call from any task.
+	Pose get_pose() const;
+
+	// Moves the pose, taking effect before the next update. Only one task
+	// at a time may call this.
+	void set_pose(const Pose &pose);
+
+	private:
+	static void task_entry(void *odometry);
+
+	void update();
+
+	void publish(double x, double y, double heading, uint32_t time_ms);
+
+	DriveMotorGroup &m_LeftDrive;
+	DriveMotorGroup &m_RightDrive;
+	ImuSampler &m_Imu;
+
+	// Seqlock around the published pose, odd while it is being written
+	std::atomic<uint32_t> m_Sequence = 0;
+	std::atomic<float> m_X = 0.0f;
+	std::atomic<float> m_Y = 0.0f;
+	std::atomic<float> m_Heading = 0.0f;
+	std::atomic<uint32_t> m_TimeMs = 0;
+
+	Pose m_ResetPose = {};
+	std::atomic<bool> m_ResetPending = false;
+
+	// Only touched by the odometry task
+	double m_LastLeft = 0.0;
+	double m_LastRight = 0.0;
+	double m_PoseX = 0.0;
+	double m_PoseY = 0.0;
+	double m_PoseHeading = 0.0;
+	// Added to the IMU's rotation so heading carries on smoothly from the
+	// encoder estimate once it is calibrated
+	double m_ImuOffset = 0.0;
+	bool m_ImuReady = false;
+};
@@ -0,0 +1,94 @@
+#include "pure_pursuit.h"
+
+#include "constants.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define DEGREES_TO_RADIANS (M_PI / 180.0)
+// Slowest fraction of max_voltage the end of a path is driven at
+#define PATH_MIN_SPEED_FRACTION 0.25
+
+/*
+ * Furthest along intersection of the circle around (x, y) with the segment
+ * from a to b, as a fraction of the segment, or -1 if there isn't one.
+ */
+static double circle_segment_intersection(double x, double y, double radius,
+					  const PathPoint &a,
+					  const PathPoint &b)
+{
+	double dx = b.x - a.x;
+	double dy = b.y - a.y;
+	double fx = a.x - x;
+	double fy = a.y - y;
+
+	double qa = dx * dx + dy * dy;
+	double qb = 2.0 * (fx * dx + fy * dy);
+	double qc = fx * fx + fy * fy - radius * radius;
+	double discriminant = qb * qb - 4.0 * qa * qc;
+	if (qa == 0.0 || discriminant < 0.0)
+		return -1.0;
+
+	double root = sqrt(discriminant);
+	double far = (-qb + root) / (2.0 * qa);
+	double near = (-qb - root) / (2.0 * qa);
+	if (far >= 0.0 && far <= 1.0)
+		return far;
+	if (near >= 0.0 && near <= 1.0)
+		return near;
+	return -1.0;
+}
+
+PursuitCommand pure_pursuit(const Pose &pose, const FollowPath &path,
+			    size_t &segment)
+{
+	const PathPoint &end = path.points[path.num_points - 1];
+	double distance_to_end = hypot(end.x - pose.x, end.y - pose.y);
+
+	// Aim for the last point once it is within reach, otherwise for the
+	// furthest point the lookahead circle crosses, or failing that the end
+	// of the current segment to get back onto the path
+	PathPoint target = path.points[std::min<size_t>(segment + 1,
+							path.num_points - 1)];
+	if (distance_to_end <= path.lookahead) {
+		target = end;
+	} else {
+		for (size_t i = segment; i + 1 < path.num_points; i++) {
+			const PathPoint &a = path.points[i];
+			const PathPoint &b = path.points[i + 1];
+			double t = circle_segment_intersection(
+				pose.x, pose.y, path.lookahead, a, b);
+			if (t < 0.0)
+				continue;
+			target = { (float)(a.x + t * (b.x - a.x)),
+				   (float)(a.y + t * (b.y - a.y)) };
+			segment = i;
+		}
+	}
+
+	// Driving backwards is driving forwards with the robot turned around
+	double heading = pose.heading + (path.reversed ? 180.0 : 0.0);
+	double dx = target.x - pose.x;
+	double dy = target.y - pose.y;
+	double right_offset = -dx * sin(heading * DEGREES_TO_RADIANS) +
+			      dy * cos(heading * DEGREES_TO_RADIANS);
+	double distance_sq = std::max(dx * dx + dy * dy, 1e-6);
+	double curvature = 2.0 * right_offset / distance_sq;
+
+	double speed = path.max_voltage *
+		       std::clamp(distance_to_end / path.lookahead,
+				  PATH_MIN_SPEED_FRACTION, 1.0);
+	double left = speed * (1.0 + curvature * DRIVE_TRACK_WIDTH_IN / 2.0);
+	double right = speed * (1.0 - curvature * DRIVE_TRACK_WIDTH_IN / 2.0);
+
+	// Keep the ratio between the sides when one would go over the limit
+	double largest = std::max(std::abs(left), std::abs(right));
+	if (largest > path.max_voltage) {
+		left *= path.max_voltage / largest;
+		right *= path.max_voltage / largest;
+	}
+
+	if (path.reversed)
+		return { (float)-right, (float)-left, (float)distance_to_end };
+	return { (float)left, (float)right, (float)distance_to_end };
+}
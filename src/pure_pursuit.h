@@ -0,0 +1,24 @@
+#pragma once
+
+#include "auto_step.h"
+#include "odometry.h"
+
+#include <cstddef>
+
+// How close to the end of a path counts as having reached it, in inches
+#define PATH_END_RANGE 1.5
+
+struct PursuitCommand {
+	// Left and right drive voltage
+	float left;
+	float right;
+	float distance_to_end;
+};
+
+/*
+ * One step of pure pursuit along path from pose. segment is the index of the
+ * path segment the lookahead point was last on, so it never goes backwards;
+ * start it at 0.
+ */
+PursuitCommand pure_pursuit(const Pose &pose, const FollowPath &path,
+			    size_t &segment);
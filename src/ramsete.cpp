@@ -0,0 +1,78 @@
+#include "ramsete.h"
+
+#include "constants.h"
+
+#include <cmath>
+
+#define DEGREES_TO_RADIANS (M_PI / 180.0)
+
+// Angle in radians wrapped into [-pi, pi]
+static double wrap_radians(double angle)
+{
+	return atan2(sin(angle), cos(angle));
+}
+
+static double sinc(double x)
+{
+	if (std::abs(x) < 1e-6)
+		return 1.0;
+	return sin(x) / x;
+}
+
+static TrajectoryPoint sample(const FollowTrajectory &trajectory,
+			      double time_s, size_t &index)
+{
+	while (index + 1 < trajectory.num_points &&
+	       trajectory.points[index + 1].time_s <= time_s)
+		index++;
+	const TrajectoryPoint &a = trajectory.points[index];
+	if (index + 1 >= trajectory.num_points)
+		return a;
+
+	const TrajectoryPoint &b = trajectory.points[index + 1];
+	double t = (time_s - a.time_s) / (b.time_s - a.time_s);
+	double heading_change =
+		wrap_radians((b.heading - a.heading) * DEGREES_TO_RADIANS) /
+		DEGREES_TO_RADIANS;
+	return { (float)time_s,
+		 (float)(a.x + t * (b.x - a.x)),
+		 (float)(a.y + t * (b.y - a.y)),
+		 (float)(a.heading + t * heading_change),
+		 (float)(a.velocity + t * (b.velocity - a.velocity)),
+		 (float)(a.curvature + t * (b.curvature - a.curvature)) };
+}
+
+RamseteCommand ramsete(const Pose &pose, const FollowTrajectory &trajectory,
+		       double time_s, size_t &index)
+{
+	TrajectoryPoint goal = sample(trajectory, time_s, index);
+
+	// RAMSETE is written with y to the left and angles counter-clockwise,
+	// so flip both from the field frame
+	double theta = -pose.heading * DEGREES_TO_RADIANS;
+	double goal_theta = -goal.heading * DEGREES_TO_RADIANS;
+	double dx = goal.x - pose.x;
+	double dy = -(goal.y - pose.y);
+	double error_x = cos(theta) * dx + sin(theta) * dy;
+	double error_y = -sin(theta) * dx + cos(theta) * dy;
+	double error_theta = wrap_radians(goal_theta - theta);
+
+	double goal_velocity = goal.velocity;
+	double goal_omega = goal.velocity * -goal.curvature;
+	double gain = 2.0 * RAMSETE_ZETA *
+		      sqrt(goal_omega * goal_omega +
+			   RAMSETE_B * goal_velocity * goal_velocity);
+	double velocity = goal_velocity * cos(error_theta) + gain * error_x;
+	double omega = goal_omega + gain * error_theta +
+		       RAMSETE_B * goal_velocity * sinc(error_theta) * error_y;
+
+	// Inches a second to motor RPM through the drive's encoder degrees
+	double to_rpm = DRIVE_UNITS_PER_INCH / 6.0;
+	double left = velocity - omega * DRIVE_TRACK_WIDTH_IN / 2.0;
+	double right = velocity + omega * DRIVE_TRACK_WIDTH_IN / 2.0;
+
+	const TrajectoryPoint &last =
+		trajectory.points[trajectory.num_points - 1];
+	return { (float)(left * to_rpm), (float)(right * to_rpm),
+		 (float)hypot(dx, dy), time_s >= last.time_s };
+}
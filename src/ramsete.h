@@ -0,0 +1,26 @@
+#pragma once
+
+#include "auto_step.h"
+#include "odometry.h"
+
+#include <cstddef>
+
+// Gains in inches. These are the usual b = 2 / m^2 and zeta = 0.7.
+#define RAMSETE_B (2.0 / (39.37 * 39.37))
+#define RAMSETE_ZETA 0.7
+
+struct RamseteCommand {
+	// Wheel speeds to hold, in drive motor RPM
+	float left_rpm;
+	float right_rpm;
+	// How far the robot is from where it should be, in inches
+	float error;
+	bool finished;
+};
+
+/*
+ * One step of RAMSETE along trajectory at time_s from its start. index is
+ * the point the last call had reached, so start it at 0.
+ */
+RamseteCommand ramsete(const Pose &pose, const FollowTrajectory &trajectory,
+		       double time_s, size_t &index);
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Binary autonomous routine format, shared by the robot's loader and the
+ * tools/routinec host compiler. All fields are little endian.
+ *
+ * A file is a RoutineHeader followed by num_steps records. Each record is a
+ * RoutineRecord followed by num_args floats, whose meaning depends on op.
+ */
+
+#define ROUTINE_MAGIC 0x54525856 // "VXRT"
+#define ROUTINE_VERSION 4
+
+struct RoutineHeader {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t num_steps;
+};
+
+enum class RoutineOp : uint8_t {
+	WaitUntilMatchTime, // clock_time_s
+	ResetIMU,
+	TurnIMU, // degrees, left_v, right_v, target_range
+	Drive, // left_target, right_target, left_speed, right_speed
+	IntakeSetExtend, // rpm
+	IntakeSpin, // voltage
+	DeployCatapult,
+	WaitForCatapultDeploy,
+	FireCatapultTime, // voltage
+	WaitForCatapultEngage,
+	WaitForCatapultSlip,
+	NamedAction, // flags holds the RoutineNamedAction
+	Join,
+	WaitForIMU,
+};
+
+// RoutineRecord::flags bits
+#define ROUTINE_FLAG_COUNTER_CLOCKWISE (1 << 0)
+#define ROUTINE_FLAG_INTAKE_EXTEND (1 << 0)
+#define ROUTINE_FLAG_CHAINED (1 << 0)
+// Drive records keep each side's MotorAction in two bits
+#define ROUTINE_LEFT_ACTION_SHIFT 1
+#define ROUTINE_RIGHT_ACTION_SHIFT 3
+#define ROUTINE_ACTION_MASK 0x3
+#define ROUTINE_FLAG_HOLD_HEADING (1 << 5)
+
+#define ROUTINE_MAX_ARGS 4
+
+struct RoutineRecord {
+	uint8_t op;
+	uint8_t tracks;
+	uint8_t flags;
+	uint8_t num_args;
+	uint8_t priority; // StepPriority
+	uint8_t settle_rpm; // drive steps, 0 for the default
+	uint16_t delay_ms_after_done;
+	uint16_t cost_ms;
+	// Drive steps, in tenths of a drive unit, 0 for the default
+	uint16_t settle_range_tenths;
+	float timeout_ms;
+};
+
+static_assert(sizeof(RoutineHeader) == 8);
+static_assert(sizeof(RoutineRecord) == 16);
+
+/*
+ * Tasks and blocking functions a routine file can run by name, since function
+ * pointers can't be stored in it. The robot keeps a matching table of actions.
+ */
+enum class RoutineNamedAction : uint8_t {
+	FireCatapultMatch,
+	FireCatapultSkills,
+	WingsOut,
+	WingsIn,
+	Count,
+};
+
+static const char *const routine_named_action_names[] = {
+	"fire_catapult_match",
+	"fire_catapult_skills",
+	"wings_out",
+	"wings_in",
+};
+
+static_assert(sizeof(routine_named_action_names) /
+		      sizeof(routine_named_action_names[0]) ==
+	      (size_t)RoutineNamedAction::Count);
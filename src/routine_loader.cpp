@@ -0,0 +1,155 @@
+#include "routine_loader.h"
+
+#include <cstdio>
+
+// Number of float arguments each RoutineOp is stored with
+static const uint8_t routine_op_num_args[] = {
+	1, // WaitUntilMatchTime
+	0, // ResetIMU
+	4, // TurnIMU
+	4, // Drive
+	1, // IntakeSetExtend
+	1, // IntakeSpin
+	0, // DeployCatapult
+	0, // WaitForCatapultDeploy
+	1, // FireCatapultTime
+	0, // WaitForCatapultEngage
+	0, // WaitForCatapultSlip
+	0, // NamedAction
+	0, // Join
+	0, // WaitForIMU
+};
+
+static bool decode_action(const RoutineRecord &record, const float *args,
+			  const AutoAction *named_actions,
+			  AutoAction &action)
+{
+	switch ((RoutineOp)record.op) {
+	case RoutineOp::WaitUntilMatchTime:
+		action = WaitUntilMatchTime{ args[0] };
+		break;
+	case RoutineOp::ResetIMU:
+		action = ResetIMU{};
+		break;
+	case RoutineOp::TurnIMU:
+		action = TurnIMUFromStart{
+			args[0], args[3], args[1], args[2],
+			record.flags & ROUTINE_FLAG_COUNTER_CLOCKWISE ?
+				Direction::CounterClockwise :
+				Direction::Clockwise
+		};
+		break;
+	case RoutineOp::Drive: {
+		uint8_t left_action =
+			(record.flags >> ROUTINE_LEFT_ACTION_SHIFT) &
+			ROUTINE_ACTION_MASK;
+		uint8_t right_action =
+			(record.flags >> ROUTINE_RIGHT_ACTION_SHIFT) &
+			ROUTINE_ACTION_MASK;
+		if (left_action > (uint8_t)MotorAction::Brake ||
+		    right_action > (uint8_t)MotorAction::Brake)
+			return false;
+
+		DriveAction drive = {
+			{ (MotorAction)left_action, args[0], args[2] },
+			{ (MotorAction)right_action, args[1], args[3] },
+			1,
+			(record.flags & ROUTINE_FLAG_CHAINED) != 0,
+			(record.flags & ROUTINE_FLAG_HOLD_HEADING) != 0,
+			record.settle_range_tenths / 10.0f,
+			(float)record.settle_rpm,
+		};
+		// Same rule as AutoStep::move_position(), which waits for
+		// both sides, and drive_power(), which only times out
+		if (drive.left.action == MotorAction::MoveAbsolute &&
+		    drive.right.action == MotorAction::MoveAbsolute)
+			drive.required_num_to_procede = 2;
+		action = drive;
+		break;
+	}
+	case RoutineOp::IntakeSetExtend:
+		action = IntakeSetExtend{
+			args[0],
+			(record.flags & ROUTINE_FLAG_INTAKE_EXTEND) != 0
+		};
+		break;
+	case RoutineOp::IntakeSpin:
+		action = IntakeSpin{ args[0] };
+		break;
+	case RoutineOp::DeployCatapult:
+		action = DeployCatapult{};
+		break;
+	case RoutineOp::WaitForCatapultDeploy:
+		action = WaitForCatapultDeploy{};
+		break;
+	case RoutineOp::FireCatapultTime:
+		action = FireCatapultTime{ args[0] };
+		break;
+	case RoutineOp::WaitForCatapultEngage:
+		action = WaitForCatapultEngage{};
+		break;
+	case RoutineOp::WaitForCatapultSlip:
+		action = WaitForCatapultSlip{};
+		break;
+	case RoutineOp::NamedAction:
+		if (record.flags >= (uint8_t)RoutineNamedAction::Count)
+			return false;
+		action = named_actions[record.flags];
+		break;
+	case RoutineOp::Join:
+		action = Join{};
+		break;
+	case RoutineOp::WaitForIMU:
+		action = WaitForIMU{};
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+bool load_routine(const char *path, std::vector<AutoStep> &steps,
+		  const AutoAction *named_actions)
+{
+	steps.clear();
+
+	FILE *file = fopen(path, "rb");
+	if (file == nullptr)
+		return false;
+
+	RoutineHeader header;
+	bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+		  header.magic == ROUTINE_MAGIC &&
+		  header.version == ROUTINE_VERSION;
+	if (ok)
+		steps.reserve(header.num_steps);
+
+	for (uint16_t i = 0; ok && i < header.num_steps; i++) {
+		RoutineRecord record;
+		float args[ROUTINE_MAX_ARGS];
+		AutoAction action;
+
+		ok = fread(&record, sizeof(record), 1, file) == 1 &&
+		     record.op < sizeof(routine_op_num_args) &&
+		     record.tracks != 0 && !(record.tracks & ~AllTracks) &&
+		     record.priority <= (uint8_t)StepPriority::Critical &&
+		     (record.priority != (uint8_t)StepPriority::Critical ||
+		      record.cost_ms != 0) &&
+		     record.num_args == routine_op_num_args[record.op] &&
+		     fread(args, sizeof(float), record.num_args, file) ==
+			     record.num_args &&
+		     decode_action(record, args, named_actions, action);
+		if (ok) {
+			steps.push_back(AutoStep{
+				action, record.timeout_ms,
+				record.delay_ms_after_done, record.tracks,
+				(StepPriority)record.priority,
+				record.cost_ms });
+		}
+	}
+
+	fclose(file);
+	if (!ok)
+		steps.clear();
+	return ok;
+}
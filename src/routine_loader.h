@@ -0,0 +1,16 @@
+#pragma once
+
+#include "auto_step.h"
+#include "routine_format.h"
+
+#include <vector>
+
+/*
+ * Reads a routine compiled by tools/routinec into steps, replacing anything
+ * already there. named_actions must hold one action per RoutineNamedAction.
+ *
+ * Returns false, leaving steps empty, if the file can't be read or is not a
+ * valid routine.
+ */
+bool load_routine(const char *path, std::vector<AutoStep> &steps,
+		  const AutoAction *named_actions);
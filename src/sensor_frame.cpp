@@ -0,0 +1,26 @@
+#include "sensor_frame.h"
+
+#include "pros/rtos.h"
+
+SensorFrame::SensorFrame(
+	const DriveMotorGroup &left_drive_group,
+	const DriveMotorGroup &right_drive_group,
+	const IntakeExtensionMotorGroup &intake_extension_group,
+	const IntakeSpinMotorGroup &intake_spin_group,
+	const CatapultMotorGroup &catapult_group)
+	: left_drive(left_drive_group), right_drive(right_drive_group),
+	  intake_extension(intake_extension_group),
+	  intake_spin(intake_spin_group), catapult(catapult_group)
+{
+}
+
+void SensorFrame::sample(const Odometry &odometry)
+{
+	time_ms = pros::c::millis();
+	left_drive.sample();
+	right_drive.sample();
+	intake_extension.sample();
+	intake_spin.sample();
+	catapult.sample();
+	pose = odometry.get_pose();
+}
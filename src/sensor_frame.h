@@ -0,0 +1,99 @@
+#pragma once
+
+#include "motor_group.h"
+#include "odometry.h"
+#include "ports.h"
+#include "velocity_estimator.h"
+#include "pros/error.h"
+#include "pros/motors.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+/*
+ * Every reading control code takes from one motor group, sampled at once.
+ * Motors that don't answer are left out of the averages.
+ */
+template <size_t N> struct MotorGroupFrame {
+	MotorGroupFrame(const MotorGroup<N> &group)
+		: group(group)
+	{
+	}
+
+	void sample()
+	{
+		std::array<uint32_t, N> timestamps;
+		std::array<int32_t, N> raw_positions =
+			group.get_raw_positions(timestamps);
+		positions = group.get_positions();
+		currents = group.get_current_draws();
+
+		double position_sum = 0.0;
+		double velocity_sum = 0.0;
+		size_t count = 0;
+		for (size_t i = 0; i < N; i++) {
+			if (raw_positions[i] == PROS_ERR ||
+			    positions[i] == PROS_ERR_F)
+				continue;
+			velocities[i] = estimators[i].update(raw_positions[i],
+							     timestamps[i]);
+			reading_ms = std::max(reading_ms, timestamps[i]);
+			position_sum += positions[i];
+			velocity_sum += velocities[i];
+			count++;
+		}
+		if (count > 0) {
+			position = position_sum / count;
+			velocity = velocity_sum / count;
+		}
+	}
+
+	const MotorGroup<N> &group;
+	// Encoder degrees, RPM and mA of each motor. Velocities are estimated
+	// from the raw encoder timestamps rather than read from the motor.
+	std::array<double, N> positions = {};
+	std::array<double, N> velocities = {};
+	std::array<int32_t, N> currents = {};
+	std::array<VelocityEstimator, N> estimators;
+	// Device time of the newest motor reading, which only moves on when a
+	// motor reports a new position
+	uint32_t reading_ms = 0;
+	double position = 0.0;
+	double velocity = 0.0;
+};
+
+typedef MotorGroup<std::size(INTAKE_EXTENSION_PORTS)> IntakeExtensionMotorGroup;
+typedef MotorGroup<std::size(INTAKE_SPIN_PORTS)> IntakeSpinMotorGroup;
+typedef MotorGroup<std::size(CATAPULT_DRIVE_PORTS)> CatapultMotorGroup;
+
+typedef MotorGroupFrame<DriveMotorGroup::size()> DriveGroupFrame;
+
+/*
+ * Snapshot of the robot's sensors, taken once at the start of each control
+ * tick so everything that runs in the tick sees the same readings. Sampling
+ * goes straight through the C API into fixed arrays, so it doesn't
+ * allocate.
+ */
+struct SensorFrame {
+	SensorFrame(const DriveMotorGroup &left_drive_group,
+		    const DriveMotorGroup &right_drive_group,
+		    const IntakeExtensionMotorGroup &intake_extension_group,
+		    const IntakeSpinMotorGroup &intake_spin_group,
+		    const CatapultMotorGroup &catapult_group);
+
+	void sample(const Odometry &odometry);
+
+	uint32_t time_ms = 0;
+	DriveGroupFrame left_drive;
+	DriveGroupFrame right_drive;
+	MotorGroupFrame<IntakeExtensionMotorGroup::size()> intake_extension;
+	MotorGroupFrame<IntakeSpinMotorGroup::size()> intake_spin;
+	MotorGroupFrame<CatapultMotorGroup::size()> catapult;
+	// Latest published pose, so every controller in the tick steers from
+	// the same heading
+	Pose pose = {};
+};
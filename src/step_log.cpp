@@ -0,0 +1,41 @@
+#include "step_log.h"
+
+static const char *const step_exit_names[] = {
+	"condition",
+	"timeout",
+	"lambda",
+	"skipped",
+};
+
+void StepLog::clear()
+{
+	m_Next = 0;
+	m_Count = 0;
+}
+
+void StepLog::add(const StepRecord &record)
+{
+	m_Records[m_Next] = record;
+	m_Next = (m_Next + 1) % STEP_LOG_SIZE;
+	if (m_Count < STEP_LOG_SIZE)
+		m_Count++;
+}
+
+void StepLog::dump(FILE *file) const
+{
+	fprintf(file, "step,action,start_ms,end_ms,duration_ms,exit,"
+		      "error_0,error_1\n");
+	size_t first = (m_Next + STEP_LOG_SIZE - m_Count) % STEP_LOG_SIZE;
+	for (size_t i = 0; i < m_Count; i++) {
+		const StepRecord &record =
+			m_Records[(first + i) % STEP_LOG_SIZE];
+		fprintf(file, "%u,%u,%lu,%lu,%lu,%s,%.2f,%.2f\n",
+			(unsigned)record.step_index,
+			(unsigned)record.action_index,
+			(unsigned long)record.start_ms,
+			(unsigned long)record.end_ms,
+			(unsigned long)(record.end_ms - record.start_ms),
+			step_exit_names[(size_t)record.exit], record.errors[0],
+			record.errors[1]);
+	}
+}
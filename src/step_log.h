@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+#define STEP_LOG_SIZE 64
+
+enum class StepExit : uint8_t {
+	Condition,
+	Timeout,
+	Lambda,
+	Skipped,
+};
+
+/*
+ * What happened to one autonomous step. Times are milliseconds since the
+ * start of autonomous. errors holds the step's remaining error when it ended:
+ * degrees of heading for turns, and left/right encoder degrees for drives.
+ */
+struct StepRecord {
+	uint32_t start_ms;
+	uint32_t end_ms;
+	uint16_t step_index;
+	uint8_t action_index;
+	StepExit exit;
+	float errors[2];
+};
+
+/*
+ * Fixed size ring buffer of the most recent STEP_LOG_SIZE steps. Adding a
+ * record never allocates, so it is safe to do every tick.
+ */
+class StepLog {
+	public:
+	void clear();
+
+	void add(const StepRecord &record);
+
+	// Writes every record, oldest first, as CSV
+	void dump(FILE *file) const;
+
+	private:
+	StepRecord m_Records[STEP_LOG_SIZE];
+	size_t m_Next = 0;
+	size_t m_Count = 0;
+};
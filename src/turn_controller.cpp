@@ -0,0 +1,71 @@
+#include "turn_controller.h"
+
+#include "okapi/impl/util/timer.hpp"
+
+#include <cmath>
+#include <memory>
+
+TurnSettledUtil::TurnSettledUtil()
+	: okapi::SettledUtil(std::make_unique<okapi::Timer>(), 0.0,
+			     TURN_SETTLE_DERIVATIVE,
+			     TURN_SETTLE_TIME_MS * okapi::millisecond)
+{
+}
+
+void TurnSettledUtil::set_target_error(double target_error)
+{
+	atTargetError = target_error;
+}
+
+void TurnController::reset(double target_range)
+{
+	m_Settled.set_target_error(target_range);
+	m_Settled.reset();
+	m_TargetRange = target_range;
+	m_LastTimeMs = 0;
+	m_LastError = 0.0;
+	m_Derivative = 0.0;
+	m_Integral = 0.0;
+	m_FirstStep = true;
+	m_IsSettled = false;
+}
+
+double TurnController::step(double error, uint32_t time_ms)
+{
+	if (m_FirstStep) {
+		m_FirstStep = false;
+		m_LastTimeMs = time_ms;
+		m_LastError = error;
+		m_IsSettled = m_Settled.isSettled(error);
+	} else if (time_ms != m_LastTimeMs) {
+		double dt = (time_ms - m_LastTimeMs) / 1000.0;
+		m_Derivative = (error - m_LastError) / dt;
+		m_LastTimeMs = time_ms;
+		m_LastError = error;
+
+		if (std::abs(error) < TURN_INTEGRAL_RANGE)
+			m_Integral += error * dt;
+		else
+			m_Integral = 0.0;
+
+		m_IsSettled = m_Settled.isSettled(error);
+	}
+
+	if (m_IsSettled)
+		return 0.0;
+
+	double output = TURN_KP * error + TURN_KI * m_Integral +
+			TURN_KD * m_Derivative;
+	if (std::abs(error) < m_TargetRange)
+		return output;
+	if (error > 0.0)
+		output += TURN_KS;
+	else
+		output -= TURN_KS;
+	return output;
+}
+
+bool TurnController::is_settled() const
+{
+	return m_IsSettled;
+}
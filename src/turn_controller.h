@@ -0,0 +1,63 @@
+#pragma once
+
+#include "okapi/api/control/util/settledUtil.hpp"
+
+#include <cstdint>
+
+// Gains on heading error in degrees, giving drive voltage out of MAX_VOLTAGE
+#define TURN_KP 4.0
+#define TURN_KI 0.02
+#define TURN_KD 0.15
+// Voltage it takes to get the drive turning at all, only added outside the
+// step's target range so it can't push the robot back and forth across it
+#define TURN_KS 12.0
+// Error the integral only builds up within, so it can't wind up mid-turn
+#define TURN_INTEGRAL_RANGE 10.0
+// A turn is done once the error has changed by less than this many degrees a
+// tick for TURN_SETTLE_TIME_MS, within the step's target range
+#define TURN_SETTLE_DERIVATIVE 0.05
+#define TURN_SETTLE_TIME_MS 60
+
+/*
+ * okapi's SettledUtil with an at-target error that can be changed, so one can
+ * be built up front and reused by every turn instead of allocated per turn
+ */
+class TurnSettledUtil : public okapi::SettledUtil {
+	public:
+	TurnSettledUtil();
+
+	void set_target_error(double target_error);
+};
+
+/*
+ * PID on heading with static friction feedforward, settled by okapi's
+ * SettledUtil so a turn only finishes once the robot has stopped on target.
+ * Within the target range the PID keeps holding the heading, without the
+ * feedforward.
+ *
+ * Heading only changes when odometry publishes a new pose, every
+ * ODOMETRY_PERIOD_MS, so the derivative, integral and settling are worked
+ * out per pose rather than per call.
+ */
+class TurnController {
+	public:
+	// Starts a new turn, settling within target_range degrees
+	void reset(double target_range);
+
+	// Voltage to turn the drive with, positive for clockwise, given the
+	// target heading minus the current one and the time_ms of the pose the
+	// current heading came from
+	double step(double error, uint32_t time_ms);
+
+	bool is_settled() const;
+
+	private:
+	TurnSettledUtil m_Settled;
+	double m_TargetRange = 0.0;
+	uint32_t m_LastTimeMs = 0;
+	double m_LastError = 0.0;
+	double m_Derivative = 0.0;
+	double m_Integral = 0.0;
+	bool m_FirstStep = true;
+	bool m_IsSettled = false;
+};
@@ -0,0 +1,34 @@
+#include "velocity_estimator.h"
+
+// Readings kept: the newest and one per update it is differenced across
+#define VELOCITY_SLOTS (VELOCITY_WINDOW + 1)
+
+double VelocityEstimator::update(int32_t raw_position, uint32_t timestamp_ms)
+{
+	size_t newest = (m_Next + VELOCITY_SLOTS - 1) % VELOCITY_SLOTS;
+	// The brain reads faster than motors update, so most reads repeat the
+	// last one
+	if (m_Count > 0 && timestamp_ms == m_Timestamps[newest])
+		return m_Velocity;
+
+	m_Positions[m_Next] = raw_position;
+	m_Timestamps[m_Next] = timestamp_ms;
+	newest = m_Next;
+	m_Next = (m_Next + 1) % VELOCITY_SLOTS;
+	if (m_Count < VELOCITY_SLOTS)
+		m_Count++;
+	if (m_Count < 2)
+		return m_Velocity;
+
+	size_t oldest = (m_Next + VELOCITY_SLOTS - m_Count) % VELOCITY_SLOTS;
+	uint32_t elapsed_ms = m_Timestamps[newest] - m_Timestamps[oldest];
+	if (elapsed_ms > 0)
+		m_Velocity = (m_Positions[newest] - m_Positions[oldest]) /
+			     VELOCITY_TICKS_PER_REV * 60000.0 / elapsed_ms;
+	return m_Velocity;
+}
+
+double VelocityEstimator::velocity() const
+{
+	return m_Velocity;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Raw encoder counts per output revolution; every motor on the robot has a
+// green cartridge
+#define VELOCITY_TICKS_PER_REV 900.0
+// Motor updates the velocity is differenced across. Motors only report a new
+// position every 10 ms, so this spans 20 ms: long enough that a single count
+// is under 4 RPM, short enough to catch a stall within a couple of ticks.
+#define VELOCITY_WINDOW 2
+
+/*
+ * Velocity of one motor from its raw encoder counts and the motor's own
+ * timestamps of them, so jitter in when the brain gets around to reading it
+ * doesn't show up as noise. Reports RPM, like get_actual_velocity() but
+ * without its filtering lag.
+ */
+class VelocityEstimator {
+	public:
+	// Takes a raw position and the device time it was measured at,
+	// returning the latest estimate
+	double update(int32_t raw_position, uint32_t timestamp_ms);
+
+	double velocity() const;
+
+	private:
+	int32_t m_Positions[VELOCITY_WINDOW + 1] = {};
+	uint32_t m_Timestamps[VELOCITY_WINDOW + 1] = {};
+	// Next slot to write and how many hold a reading
+	size_t m_Next = 0;
+	size_t m_Count = 0;
+	double m_Velocity = 0.0;
+};
@@ -0,0 +1,432 @@
+/*
+ * Compiles a text autonomous routine into the binary format the robot loads
+ * from its SD card (see src/routine_format.h). Build it with `make routinec`.
+ *
+ *	routinec <routine.txt> <routine.bin>
+ *
+ * Each line is one step, named and ordered like the AutoStep factories:
+ *
+ *	deploy_catapult
+ *	move_position -14*IN -9.5*IN MAX_RPM MAX_RPM/2.5 750
+ *	move_straight 30*IN MAX_RPM 1200
+ *	turn_imu cw 79 MAX_VOLTAGE 1500
+ *	set_intake_spin MAX_VOLTAGE 0 on=intake
+ *	run fire_catapult_match
+ *
+ * Numbers may be multiplied or divided by other numbers or by MAX_VOLTAGE,
+ * MAX_RPM, IN (drive units per inch) and DEG (drive units per degree of
+ * turn). Any step can end with these options:
+ *
+ *	on=drive|intake|catapult	tracks the step runs on (default all)
+ *	delay=<ms>			delay_ms_after_done
+ *	chained				chain a drive step into the next one
+ *	priority=critical|optional	how the step is scheduled against the
+ *					match clock (default normal)
+ *	cost=<ms>			expected run time of the step,
+ *					required on critical steps
+ *	settle=<units>[,<rpm>]		tolerances a drive step finishes
+ *					within (default DRIVE_SETTLE_RANGE
+ *					and DRIVE_SETTLE_RPM)
+ *
+ * Everything after a '#' is a comment.
+ */
+
+#include "auto_step.h"
+#include "constants.h"
+#include "routine_format.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct CompiledStep {
+	RoutineRecord record;
+	std::vector<float> args;
+};
+
+struct ParseError {
+	std::string message;
+};
+
+static bool parse_factor(const std::string &text, double &value)
+{
+	static const struct {
+		const char *name;
+		double value;
+	} names[] = {
+		{ "MAX_VOLTAGE", MAX_VOLTAGE },
+		{ "MAX_RPM", MAX_RPM },
+		{ "IN", DRIVE_UNITS_PER_INCH },
+		{ "DEG", DRIVE_UNITS_PER_DEGREE },
+	};
+
+	bool negative = !text.empty() && text[0] == '-';
+	std::string name = negative ? text.substr(1) : text;
+	for (const auto &entry : names) {
+		if (name == entry.name) {
+			value = negative ? -entry.value : entry.value;
+			return true;
+		}
+	}
+
+	char *end;
+	value = strtod(text.c_str(), &end);
+	return !text.empty() && *end == '\0';
+}
+
+// Evaluates a left-to-right chain of factors joined by '*' and '/'
+static float parse_number(const std::string &text)
+{
+	double result = 0.0;
+	size_t start = 0;
+	char op = '*';
+	bool first = true;
+	while (true) {
+		size_t end = text.find_first_of("*/", start);
+		double factor;
+		if (!parse_factor(text.substr(start, end - start), factor))
+			throw ParseError{ "invalid number '" + text + "'" };
+
+		if (first)
+			result = factor;
+		else if (op == '*')
+			result *= factor;
+		else
+			result /= factor;
+		first = false;
+
+		if (end == std::string::npos)
+			break;
+		op = text[end];
+		start = end + 1;
+	}
+	return (float)result;
+}
+
+static uint8_t parse_tracks(const std::string &text)
+{
+	uint8_t tracks = 0;
+	std::stringstream stream(text);
+	std::string name;
+	while (std::getline(stream, name, '|')) {
+		if (name == "drive")
+			tracks |= DriveTrack;
+		else if (name == "intake")
+			tracks |= IntakeTrack;
+		else if (name == "catapult")
+			tracks |= CatapultTrack;
+		else if (name == "all")
+			tracks |= AllTracks;
+		else
+			throw ParseError{ "unknown track '" + name + "'" };
+	}
+	// A step on no tracks would never be reached by any of them
+	if (tracks == 0)
+		throw ParseError{ "expected at least one track" };
+	return tracks;
+}
+
+static uint8_t parse_direction(const std::string &text)
+{
+	if (text == "cw")
+		return 0;
+	if (text == "ccw")
+		return ROUTINE_FLAG_COUNTER_CLOCKWISE;
+	throw ParseError{ "expected cw or ccw, got '" + text + "'" };
+}
+
+static uint8_t parse_priority(const std::string &text)
+{
+	if (text == "optional")
+		return (uint8_t)StepPriority::Optional;
+	if (text == "normal")
+		return (uint8_t)StepPriority::Normal;
+	if (text == "critical")
+		return (uint8_t)StepPriority::Critical;
+	throw ParseError{ "unknown priority '" + text + "'" };
+}
+
+static bool parse_bool(const std::string &text)
+{
+	if (text == "true")
+		return true;
+	if (text == "false")
+		return false;
+	throw ParseError{ "expected true or false, got '" + text + "'" };
+}
+
+// Parses a number for a record field that only holds 0 to max
+static float parse_bounded(const std::string &text, float max)
+{
+	float value = parse_number(text);
+	if (value < 0.0f || value > max)
+		throw ParseError{ "'" + text + "' is outside 0 to " +
+				  std::to_string((long)max) };
+	return value;
+}
+
+// Fills in the optional trailing arguments the AutoStep factories default
+static float arg_or(const std::vector<std::string> &words, size_t index,
+		    float fallback)
+{
+	return index < words.size() ? parse_number(words[index]) : fallback;
+}
+
+static void expect_args(const std::vector<std::string> &words, size_t min,
+			size_t max)
+{
+	if (words.size() - 1 < min || words.size() - 1 > max) {
+		throw ParseError{ words[0] + " takes " + std::to_string(min) +
+				  (min == max ? "" :
+						" to " + std::to_string(max)) +
+				  " arguments" };
+	}
+}
+
+static CompiledStep compile_step(std::vector<std::string> words)
+{
+	CompiledStep step = {};
+	step.record.tracks = AllTracks;
+	step.record.priority = (uint8_t)StepPriority::Normal;
+
+	// Options can follow any step, so strip them off first
+	bool chained = false;
+	bool has_settle = false;
+	bool has_tracks = false;
+	float delay_ms = -1;
+	while (words.size() > 1) {
+		const std::string &word = words.back();
+		if (word == "chained") {
+			chained = true;
+		} else if (word.rfind("on=", 0) == 0) {
+			step.record.tracks = parse_tracks(word.substr(3));
+			has_tracks = true;
+		} else if (word.rfind("delay=", 0) == 0) {
+			delay_ms = parse_bounded(word.substr(6), UINT16_MAX);
+		} else if (word.rfind("priority=", 0) == 0) {
+			step.record.priority = parse_priority(word.substr(9));
+		} else if (word.rfind("settle=", 0) == 0) {
+			std::string settle = word.substr(7);
+			size_t comma = settle.find(',');
+			step.record.settle_range_tenths = (uint16_t)(
+				parse_bounded(settle.substr(0, comma),
+					      UINT16_MAX / 10.0f) *
+					10.0f +
+				0.5f);
+			if (comma != std::string::npos)
+				step.record.settle_rpm = (uint8_t)parse_bounded(
+					settle.substr(comma + 1), UINT8_MAX);
+			has_settle = true;
+		} else if (word.rfind("cost=", 0) == 0) {
+			step.record.cost_ms = (uint16_t)parse_bounded(
+				word.substr(5), UINT16_MAX);
+		} else {
+			break;
+		}
+		words.pop_back();
+	}
+
+	const std::string &name = words[0];
+	auto &args = step.args;
+	auto &record = step.record;
+	if (name == "wait_until_match_time") {
+		expect_args(words, 1, 1);
+		record.op = (uint8_t)RoutineOp::WaitUntilMatchTime;
+		record.timeout_ms = 10000000;
+		args = { parse_number(words[1]) };
+	} else if (name == "reset_imu") {
+		expect_args(words, 1, 1);
+		record.op = (uint8_t)RoutineOp::ResetIMU;
+		record.timeout_ms = parse_number(words[1]);
+	} else if (name == "wait_for_imu") {
+		expect_args(words, 0, 1);
+		record.op = (uint8_t)RoutineOp::WaitForIMU;
+		record.timeout_ms = arg_or(words, 1, 3000);
+	} else if (name == "turn_imu" || name == "turn_imu_separate") {
+		// turn_imu_separate takes a voltage per side
+		size_t sides = name == "turn_imu" ? 1 : 2;
+		expect_args(words, 3 + sides, 5 + sides);
+		record.op = (uint8_t)RoutineOp::TurnIMU;
+		record.flags = parse_direction(words[1]);
+		float left_voltage = parse_number(words[3]);
+		float right_voltage = parse_number(words[2 + sides]);
+		record.timeout_ms = parse_number(words[3 + sides]);
+		record.delay_ms_after_done =
+			(uint16_t)arg_or(words, 4 + sides, 5);
+		args = { parse_number(words[2]), left_voltage, right_voltage,
+			 arg_or(words, 5 + sides, 2.0) };
+	} else if (name == "move_position") {
+		expect_args(words, 3, 5);
+		if (words.size() == 5)
+			throw ParseError{
+				"move_position takes 3 or 5 arguments"
+			};
+		record.op = (uint8_t)RoutineOp::Drive;
+		uint8_t absolute = (uint8_t)MotorAction::MoveAbsolute;
+		record.flags = absolute << ROUTINE_LEFT_ACTION_SHIFT |
+			       absolute << ROUTINE_RIGHT_ACTION_SHIFT;
+		if (words.size() == 4) {
+			float target = parse_number(words[1]);
+			float rpm = parse_number(words[2]);
+			args = { target, target, rpm, rpm };
+			record.timeout_ms = parse_number(words[3]);
+		} else {
+			args = { parse_number(words[1]), parse_number(words[2]),
+				 parse_number(words[3]),
+				 parse_number(words[4]) };
+			record.timeout_ms = parse_number(words[5]);
+		}
+	} else if (name == "move_straight") {
+		expect_args(words, 3, 3);
+		record.op = (uint8_t)RoutineOp::Drive;
+		uint8_t absolute = (uint8_t)MotorAction::MoveAbsolute;
+		record.flags = absolute << ROUTINE_LEFT_ACTION_SHIFT |
+			       absolute << ROUTINE_RIGHT_ACTION_SHIFT |
+			       ROUTINE_FLAG_HOLD_HEADING;
+		float target = parse_number(words[1]);
+		float rpm = parse_number(words[2]);
+		args = { target, target, rpm, rpm };
+		record.timeout_ms = parse_number(words[3]);
+	} else if (name == "drive_power") {
+		expect_args(words, 2, 3);
+		record.op = (uint8_t)RoutineOp::Drive;
+		float left = parse_number(words[1]);
+		float right = words.size() == 4 ? parse_number(words[2]) : left;
+		args = { 0, 0, left, right };
+		record.timeout_ms = parse_number(words.back());
+	} else if (name == "set_intake_extension") {
+		expect_args(words, 3, 3);
+		record.op = (uint8_t)RoutineOp::IntakeSetExtend;
+		record.flags = parse_bool(words[1]) ?
+				       ROUTINE_FLAG_INTAKE_EXTEND :
+				       0;
+		args = { parse_number(words[2]) };
+		record.timeout_ms = parse_number(words[3]);
+	} else if (name == "set_intake_spin") {
+		expect_args(words, 2, 2);
+		record.op = (uint8_t)RoutineOp::IntakeSpin;
+		args = { parse_number(words[1]) };
+		record.timeout_ms = parse_number(words[2]);
+	} else if (name == "deploy_catapult") {
+		expect_args(words, 0, 0);
+		record.op = (uint8_t)RoutineOp::DeployCatapult;
+	} else if (name == "wait_for_catapult_deploy") {
+		expect_args(words, 0, 1);
+		record.op = (uint8_t)RoutineOp::WaitForCatapultDeploy;
+		record.timeout_ms = arg_or(words, 1, 10000);
+	} else if (name == "fire_catapult_time") {
+		expect_args(words, 1, 2);
+		record.op = (uint8_t)RoutineOp::FireCatapultTime;
+		record.timeout_ms = parse_number(words[1]);
+		args = { arg_or(words, 2, MAX_VOLTAGE) };
+	} else if (name == "wait_for_catapult_engage") {
+		expect_args(words, 0, 0);
+		record.op = (uint8_t)RoutineOp::WaitForCatapultEngage;
+		record.timeout_ms = 2500;
+	} else if (name == "wait_for_catapult_slip") {
+		expect_args(words, 0, 0);
+		record.op = (uint8_t)RoutineOp::WaitForCatapultSlip;
+		record.timeout_ms = 2500;
+	} else if (name == "run") {
+		// Tasks run until they finish unless given a timeout
+		expect_args(words, 1, 2);
+		record.op = (uint8_t)RoutineOp::NamedAction;
+		record.timeout_ms = arg_or(words, 2, 10000000);
+		size_t i = 0;
+		while (i < (size_t)RoutineNamedAction::Count &&
+		       words[1] != routine_named_action_names[i])
+			i++;
+		if (i == (size_t)RoutineNamedAction::Count)
+			throw ParseError{ "unknown action '" + words[1] + "'" };
+		record.flags = (uint8_t)i;
+	} else if (name == "join") {
+		expect_args(words, 0, 1);
+		record.op = (uint8_t)RoutineOp::Join;
+		if (words.size() == 2 && !has_tracks)
+			record.tracks = parse_tracks(words[1]);
+	} else {
+		throw ParseError{ "unknown step '" + name + "'" };
+	}
+
+	if (delay_ms >= 0)
+		record.delay_ms_after_done = (uint16_t)delay_ms;
+	if (chained) {
+		if (record.op != (uint8_t)RoutineOp::Drive)
+			throw ParseError{ "only drive steps can be chained" };
+		record.flags |= ROUTINE_FLAG_CHAINED;
+	}
+	if (has_settle && record.op != (uint8_t)RoutineOp::Drive)
+		throw ParseError{ "only drive steps have settle tolerances" };
+	if (record.priority == (uint8_t)StepPriority::Critical &&
+	    record.cost_ms == 0)
+		throw ParseError{ "critical steps need a cost" };
+	record.num_args = (uint8_t)args.size();
+	return step;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s <routine.txt> <routine.bin>\n",
+			argv[0]);
+		return 2;
+	}
+
+	std::ifstream input(argv[1]);
+	if (!input) {
+		fprintf(stderr, "%s: can't open\n", argv[1]);
+		return 1;
+	}
+
+	std::vector<CompiledStep> steps;
+	std::string line;
+	bool failed = false;
+	for (int line_num = 1; std::getline(input, line); line_num++) {
+		line = line.substr(0, line.find('#'));
+		std::stringstream stream(line);
+		std::vector<std::string> words;
+		std::string word;
+		while (stream >> word)
+			words.push_back(word);
+		if (words.empty())
+			continue;
+
+		try {
+			steps.push_back(compile_step(words));
+		} catch (const ParseError &error) {
+			fprintf(stderr, "%s:%d: %s\n", argv[1], line_num,
+				error.message.c_str());
+			failed = true;
+		}
+	}
+	if (failed)
+		return 1;
+	if (steps.size() > UINT16_MAX) {
+		fprintf(stderr, "%s: too many steps\n", argv[1]);
+		return 1;
+	}
+
+	FILE *output = fopen(argv[2], "wb");
+	if (output == nullptr) {
+		fprintf(stderr, "%s: can't open for writing\n", argv[2]);
+		return 1;
+	}
+	RoutineHeader header = { ROUTINE_MAGIC, ROUTINE_VERSION,
+				 (uint16_t)steps.size() };
+	fwrite(&header, sizeof(header), 1, output);
+	for (const auto &step : steps) {
+		fwrite(&step.record, sizeof(step.record), 1, output);
+		fwrite(step.args.data(), sizeof(float), step.args.size(),
+		       output);
+	}
+	long size = ftell(output);
+	fclose(output);
+
+	printf("%s: %zu steps, %ld bytes\n", argv[2], steps.size(), size);
+	return 0;
+}
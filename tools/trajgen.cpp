@@ -0,0 +1,187 @@
+/*
+ * Generates motion profiles for the paths in a text file with squiggles and
+ * writes them out as constexpr TrajectoryPoint arrays, so the robot follows
+ * them with AutoStep::follow_trajectory() without generating anything itself.
+ * Build and run it with `make trajectories SQUIGGLES_DIR=<squiggles checkout>`.
+ *
+ *	trajgen <paths.txt> <trajectories.h>
+ *
+ * Each path starts with a line giving its name and limits, in inches and
+ * seconds, followed by one waypoint a line in the field frame of Pose
+ * (inches, y to the right, heading in degrees clockwise):
+ *
+ *	path to_goal 50 100 500		# max velocity, acceleration, jerk
+ *	0 0 0
+ *	24 12 45
+ *
+ * Everything after a '#' is a comment.
+ */
+
+#include "constants.h"
+
+#include "squiggles.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define INCHES_PER_METRE 39.37
+#define DEGREES_TO_RADIANS (M_PI / 180.0)
+// Time between generated points. The robot interpolates between them.
+#define TRAJECTORY_DT 0.02
+
+struct Path {
+	std::string name;
+	double max_velocity;
+	double max_accel;
+	double max_jerk;
+	std::vector<squiggles::Pose> waypoints;
+	int line_num;
+};
+
+static bool parse_numbers(std::stringstream &stream, double *values,
+			  size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (!(stream >> values[i]))
+			return false;
+	}
+	std::string rest;
+	return !(stream >> rest);
+}
+
+static void
+write_trajectory(FILE *output, const Path &path,
+		 const std::vector<squiggles::ProfilePoint> &profile)
+{
+	fprintf(output, "constexpr TrajectoryPoint %s_trajectory[] = {\n",
+		path.name.c_str());
+	// squiggles works in metres and radians counter-clockwise with y to
+	// the left, so convert into our field frame
+	for (const auto &point : profile) {
+		const squiggles::ControlVector &vector = point.vector;
+		fprintf(output,
+			"\t{ %.3ff, %.3ff, %.3ff, %.3ff, %.3ff, %.6ff },\n",
+			point.time, vector.pose.x * INCHES_PER_METRE,
+			-vector.pose.y * INCHES_PER_METRE,
+			-vector.pose.yaw / DEGREES_TO_RADIANS,
+			vector.vel * INCHES_PER_METRE,
+			-point.curvature / INCHES_PER_METRE);
+	}
+	fprintf(output, "};\n\n");
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s <paths.txt> <trajectories.h>\n",
+			argv[0]);
+		return 2;
+	}
+
+	std::ifstream input(argv[1]);
+	if (!input) {
+		fprintf(stderr, "%s: can't open\n", argv[1]);
+		return 1;
+	}
+
+	std::vector<Path> paths;
+	std::string line;
+	bool failed = false;
+	for (int line_num = 1; std::getline(input, line); line_num++) {
+		line = line.substr(0, line.find('#'));
+		std::stringstream stream(line);
+		std::string word;
+		if (!(stream >> word))
+			continue;
+
+		if (word == "path") {
+			Path path = {};
+			double limits[3];
+			path.line_num = line_num;
+			if (!(stream >> path.name) ||
+			    !parse_numbers(stream, limits, 3)) {
+				fprintf(stderr,
+					"%s:%d: expected path <name> "
+					"<velocity> <accel> <jerk>\n",
+					argv[1], line_num);
+				failed = true;
+				continue;
+			}
+			path.max_velocity = limits[0];
+			path.max_accel = limits[1];
+			path.max_jerk = limits[2];
+			paths.push_back(path);
+			continue;
+		}
+
+		std::stringstream waypoint(line);
+		double values[3];
+		if (paths.empty() || !parse_numbers(waypoint, values, 3)) {
+			fprintf(stderr, "%s:%d: expected <x> <y> <heading>\n",
+				argv[1], line_num);
+			failed = true;
+			continue;
+		}
+		paths.back().waypoints.emplace_back(
+			values[0] / INCHES_PER_METRE,
+			-values[1] / INCHES_PER_METRE,
+			-values[2] * DEGREES_TO_RADIANS);
+	}
+	if (failed)
+		return 1;
+
+	FILE *output = fopen(argv[2], "w");
+	if (output == nullptr) {
+		fprintf(stderr, "%s: can't open for writing\n", argv[2]);
+		return 1;
+	}
+	fprintf(output, "// Generated by tools/trajgen from %s, don't edit.\n\n"
+			"#pragma once\n\n#include \"auto_step.h\"\n\n",
+		argv[1]);
+
+	for (const auto &path : paths) {
+		if (path.waypoints.size() < 2) {
+			fprintf(stderr,
+				"%s:%d: %s needs at least 2 waypoints\n",
+				argv[1], path.line_num, path.name.c_str());
+			failed = true;
+			continue;
+		}
+
+		squiggles::Constraints constraints(
+			path.max_velocity / INCHES_PER_METRE,
+			path.max_accel / INCHES_PER_METRE,
+			path.max_jerk / INCHES_PER_METRE);
+		squiggles::SplineGenerator generator(
+			constraints,
+			std::make_shared<squiggles::TankModel>(
+				DRIVE_TRACK_WIDTH_IN / INCHES_PER_METRE,
+				constraints),
+			TRAJECTORY_DT);
+		std::vector<squiggles::ProfilePoint> profile =
+			generator.generate(path.waypoints);
+		if (profile.empty()) {
+			fprintf(stderr, "%s:%d: no profile fits %s\n", argv[1],
+				path.line_num, path.name.c_str());
+			failed = true;
+			continue;
+		}
+
+		write_trajectory(output, path, profile);
+		printf("%s: %zu points, %.2f s\n", path.name.c_str(),
+		       profile.size(), profile.back().time);
+	}
+	fclose(output);
+
+	if (failed) {
+		remove(argv[2]);
+		return 1;
+	}
+	return 0;
+}